@@ -0,0 +1,102 @@
+#pragma once
+#include "config.h"
+#include "trade.h"
+#include <algorithm>
+#include <initializer_list>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace trading {
+
+// 成交聚合器接口：
+//   onTrade(trade)  按时间顺序逐笔调用
+//   onFlush()       全部成交处理完后调用一次，输出尚未结束的部分
+// 多个聚合器通过 runAggregators 在同一次遍历中处理每笔成交，成交只需读入缓存一次
+
+template <typename... Aggregators>
+void runAggregators(std::span<const Trade> trades, Aggregators&... aggregators) {
+    for (const auto& trade : trades) {
+        (aggregators.onTrade(trade), ...);
+    }
+    (aggregators.onFlush(), ...);
+}
+
+struct AggTrade {
+    int64_t id;
+    double price;
+    int64_t qty;  // lots
+    double quoteQty;
+    int64_t time;
+    bool isBuyerMaker;
+    int count;
+};
+
+// 按 preAggDuration 毫秒窗口分别合并买卖两侧的连续成交。
+// 每侧的聚合记录按时间顺序产生，结束时两侧线性归并即按时间和ID有序
+class AggTradeAggregator {
+public:
+    explicit AggTradeAggregator(const SymbolConfig& config)
+        : preAggDuration_(config.preAggDuration) {}
+
+    void onTrade(const Trade& trade) {
+        int64_t ts = (trade.time * 1000 / preAggDuration_) * preAggDuration_;
+        Side& side = trade.isBuyerMaker ? buySide_ : sellSide_;
+
+        // 同侧聚合记录的时间窗口不同时输出并重新开始
+        if (side.open && side.trade.time != ts) {
+            side.emitted.push_back(side.trade);
+            side.open = false;
+        }
+
+        if (!side.open) {
+            side.trade = AggTrade{trade.id, trade.price, trade.lots, trade.quoteQty,
+                                  ts, trade.isBuyerMaker, 1};
+            side.open = true;
+        } else {
+            side.trade.qty += trade.lots;
+            side.trade.quoteQty += trade.quoteQty;
+            side.trade.count++;
+        }
+    }
+
+    void onFlush() {
+        for (Side* side : {&buySide_, &sellSide_}) {
+            if (side->open) {
+                side->emitted.push_back(side->trade);
+                side->open = false;
+            }
+        }
+
+        // 两侧各自有序，按时间和ID归并
+        size_t offset = aggregated_.size();
+        aggregated_.resize(offset + buySide_.emitted.size() + sellSide_.emitted.size());
+        std::merge(buySide_.emitted.begin(), buySide_.emitted.end(),
+                   sellSide_.emitted.begin(), sellSide_.emitted.end(),
+                   aggregated_.begin() + static_cast<std::ptrdiff_t>(offset),
+                   [](const AggTrade& a, const AggTrade& b) {
+                       if (a.time == b.time)
+                           return a.id < b.id;
+                       return a.time < b.time;
+                   });
+        buySide_.emitted = std::vector<AggTrade>();
+        sellSide_.emitted = std::vector<AggTrade>();
+    }
+
+    std::vector<AggTrade>& aggregated() { return aggregated_; }
+
+private:
+    struct Side {
+        AggTrade trade{};
+        bool open{false};
+        std::vector<AggTrade> emitted;  // 已结束的聚合记录，按时间有序
+    };
+
+    int64_t preAggDuration_;
+    Side buySide_;
+    Side sellSide_;
+    std::vector<AggTrade> aggregated_;
+};
+
+} // namespace trading
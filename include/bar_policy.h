@@ -0,0 +1,192 @@
+#pragma once
+#include "config.h"
+#include "footprint.h"
+#include "precision.h"
+#include "session_calendar.h"
+#include "trade.h"
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+
+namespace trading {
+
+// K线收线策略：
+//   open(tick)          新K线的第一笔成交，返回K线时间戳
+//   accepts(bar, tick)  成交是否仍属于当前K线
+//   update(tick)        成交计入当前K线之后调用
+
+// 按时间收线，K线与 duration 对齐。配置了时区或session起点时按 SessionCalendar
+// 预先生成的边界对齐，两种情况下判断成交是否属于当前K线都只需与 end 比较
+struct TimeBarPolicy {
+    static constexpr bool kTimeBased = true;
+
+    int64_t duration;
+    int64_t end{0};  // 当前K线的结束时刻
+    std::optional<SessionCalendar> calendar;
+
+    explicit TimeBarPolicy(const SymbolConfig& config)
+        : duration(config.duration) {
+        if (config.sessionAligned()) {
+            calendar.emplace(config, config.duration);
+        }
+    }
+
+    // 打开包含 time 的K线，返回K线时间戳
+    int64_t openAt(int64_t time) {
+        if (calendar) {
+            int64_t start = calendar->open(time);
+            end = calendar->end();
+            return start;
+        }
+        int64_t start = time / duration * duration;
+        end = start + duration;
+        return start;
+    }
+
+    int64_t open(const Trade& tick) { return openAt(tick.time); }
+
+    bool accepts(const FootprintBar& bar, const Trade& tick) const {
+        return tick.time >= bar.timestamp && tick.time < end;
+    }
+
+    void update(const Trade&) {}
+};
+
+// 成交量达到 barSize 后收线
+struct VolumeBarPolicy {
+    static constexpr bool kTimeBased = false;
+
+    int64_t threshold;  // lots
+
+    explicit VolumeBarPolicy(const SymbolConfig& config)
+        : threshold(RuntimePrecision(config).toLots(config.barSize)) {}
+
+    int64_t open(const Trade& tick) const { return tick.time; }
+
+    bool accepts(const FootprintBar& bar, const Trade&) const {
+        return bar.volume < threshold;
+    }
+
+    void update(const Trade&) {}
+};
+
+// 成交笔数达到 barSize 后收线
+struct TickBarPolicy {
+    static constexpr bool kTimeBased = false;
+
+    int64_t threshold;
+
+    explicit TickBarPolicy(const SymbolConfig& config)
+        : threshold(static_cast<int64_t>(config.barSize)) {}
+
+    int64_t open(const Trade& tick) const { return tick.time; }
+
+    bool accepts(const FootprintBar& bar, const Trade&) const {
+        return bar.tradesCount < threshold;
+    }
+
+    void update(const Trade&) {}
+};
+
+// 成交额(quote notional)达到 barSize 后收线
+struct DollarBarPolicy {
+    static constexpr bool kTimeBased = false;
+
+    double threshold;
+    double notional{0.0};
+
+    explicit DollarBarPolicy(const SymbolConfig& config)
+        : threshold(config.barSize) {}
+
+    int64_t open(const Trade& tick) {
+        notional = 0.0;
+        return tick.time;
+    }
+
+    bool accepts(const FootprintBar&, const Trade&) const {
+        return notional < threshold;
+    }
+
+    void update(const Trade& tick) { notional += tick.quoteQty; }
+};
+
+// 区间K线：成交使高低点区间超过 barSize 个tick时收线，该成交开启新K线
+struct RangeBarPolicy {
+    static constexpr bool kTimeBased = false;
+
+    int64_t rangeTicks;
+    double priceMultiplier;
+    int64_t highTicks{0};
+    int64_t lowTicks{0};
+
+    explicit RangeBarPolicy(const SymbolConfig& config)
+        : rangeTicks(static_cast<int64_t>(config.barSize))
+        , priceMultiplier(powerOf10(config.pricePrecision)) {}
+
+    int64_t open(const Trade& tick) {
+        highTicks = lowTicks = priceToTicks(tick.price, priceMultiplier);
+        return tick.time;
+    }
+
+    bool accepts(const FootprintBar&, const Trade& tick) const {
+        int64_t ticks = priceToTicks(tick.price, priceMultiplier);
+        return std::max(highTicks, ticks) - std::min(lowTicks, ticks) <= rangeTicks;
+    }
+
+    void update(const Trade& tick) {
+        int64_t ticks = priceToTicks(tick.price, priceMultiplier);
+        highTicks = std::max(highTicks, ticks);
+        lowTicks = std::min(lowTicks, ticks);
+    }
+};
+
+// Renko砖块：价格顺势移动一个砖块或反向移动两个砖块时收线。
+// 砖块参考价跨K线保留，开启新K线的成交决定新的参考价和方向
+struct RenkoBarPolicy {
+    static constexpr bool kTimeBased = false;
+
+    int64_t brickTicks;
+    double priceMultiplier;
+    int64_t referenceTicks{0};  // 最近一个砖块的收盘价
+    int direction{0};           // 最近砖块方向，1上涨，-1下跌，0尚无砖块
+    bool started{false};
+
+    explicit RenkoBarPolicy(const SymbolConfig& config)
+        : brickTicks(static_cast<int64_t>(config.barSize))
+        , priceMultiplier(powerOf10(config.pricePrecision)) {}
+
+    int64_t upperTicks() const {
+        return referenceTicks + brickTicks * (direction < 0 ? 2 : 1);
+    }
+
+    int64_t lowerTicks() const {
+        return referenceTicks - brickTicks * (direction > 0 ? 2 : 1);
+    }
+
+    int64_t open(const Trade& tick) {
+        int64_t ticks = priceToTicks(tick.price, priceMultiplier);
+        if (!started) {
+            referenceTicks = ticks;
+            started = true;
+        } else if (ticks >= upperTicks()) {
+            // 跳空时一次推进多个完整砖块
+            int64_t base = referenceTicks + (direction < 0 ? brickTicks : 0);
+            referenceTicks = base + (ticks - base) / brickTicks * brickTicks;
+            direction = 1;
+        } else if (ticks <= lowerTicks()) {
+            int64_t base = referenceTicks - (direction > 0 ? brickTicks : 0);
+            referenceTicks = base - (base - ticks) / brickTicks * brickTicks;
+            direction = -1;
+        }
+        return tick.time;
+    }
+
+    bool accepts(const FootprintBar&, const Trade& tick) const {
+        int64_t ticks = priceToTicks(tick.price, priceMultiplier);
+        return ticks < upperTicks() && ticks > lowerTicks();
+    }
+
+    void update(const Trade&) {}
+};
+
+} // namespace trading
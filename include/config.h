@@ -1,15 +1,49 @@
 #pragma once
 #include <string>
 #include <cstdint>
+#include <vector>
+#include <algorithm>
 
 namespace trading {
 
+enum class BarType {
+    Time,    // Close every `duration` seconds
+    Volume,  // Close once traded volume reaches `barSize`
+    Tick,    // Close once trade count reaches `barSize`
+    Dollar,  // Close once quote notional reaches `barSize`
+    Range,   // Close before high-low range exceeds `barSize` price ticks
+    Renko    // Close when price moves a `barSize`-tick brick from the last brick
+};
+
 struct SymbolConfig {
     int64_t duration;         // Bar duration in seconds
     int scale;               // Price scale
     int volumePrecision;     // Volume precision
     int pricePrecision;      // Price precision
+    int lotPrecision;        // Decimals of the exchange qty step, volumes are int64 multiples of it
     int64_t preAggDuration;  // Pre-aggregation duration in milliseconds
+    std::vector<int64_t> durations;  // Extra bar durations in seconds, rolled up from the finest
+    BarType barType;         // Bar closing policy
+    double barSize;          // Volume, trade count, notional or price ticks for non-time bars
+    double valueAreaPercent; // Share of bar volume inside the value area
+    double imbalanceRatio;   // Diagonal ask/bid ratio that marks an imbalance
+    int stackedImbalanceLevels;  // Consecutive imbalanced levels that form a stack
+    int64_t sessionDuration; // Session length in seconds for session-anchored values
+    std::vector<int64_t> profileDurations;  // Volume profile session lengths in seconds
+    int64_t profileAnchor;   // Profile sessions start at profileAnchor + k * duration
+    bool fillEmptyLevels;    // Emit untraded levels between open and close in footprint output
+    int targetLevels;        // Widen each output bar's levels to at most about this many, 0 keeps scale
+    bool fillGaps;           // Emit flat placeholder bars for time intervals without trades
+    double largeTradeSize;   // Trades at least this size count as large, 0 disables
+    double largeTradePercentile;  // Per-bar size percentile (0-1) for large trades, overrides largeTradeSize
+    int topTradeCount;       // Largest prints kept per bar
+    int64_t snapshotInterval;  // Snapshot the open bar every N seconds, 0 disables
+    int snapshotTrades;      // Snapshot the open bar every N trades, 0 disables
+    std::string timezone;    // IANA zone for session-aligned time bars, empty for UTC; read from
+                             // std::chrono's tzdb, or /usr/share/zoneinfo where the library lacks one
+    int64_t sessionOffset;   // Session start in seconds after local midnight
+    int heatmapLevels;       // Levels per bar in the delta heatmap tensor around the close, 0 disables
+    bool orderFlowFeatures;  // Write a columnar table of per-bar order-flow features
     
     // Default constructor with BTC-specific values
     SymbolConfig() 
@@ -17,17 +51,57 @@ struct SymbolConfig {
         , scale(100)
         , volumePrecision(2)
         , pricePrecision(1)
+        , lotPrecision(8)
         , preAggDuration(100)  // 100ms for pre-aggregation
+        , barType(BarType::Time)
+        , barSize(0)
+        , valueAreaPercent(0.7)
+        , imbalanceRatio(3.0)
+        , stackedImbalanceLevels(3)
+        , sessionDuration(86400)  // UTC day
+        , profileDurations{86400}  // UTC day, add 604800 for weeks
+        , profileAnchor(345600)    // Monday 1970-01-05 00:00 UTC
+        , fillEmptyLevels(true)
+        , targetLevels(0)
+        , fillGaps(false)
+        , largeTradeSize(0)
+        , largeTradePercentile(0)
+        , topTradeCount(0)
+        , snapshotInterval(0)
+        , snapshotTrades(0)
+        , sessionOffset(0)
+        , heatmapLevels(0)
+        , orderFlowFeatures(false)
     {}
+
+    // Time bars restart at each local session instead of the UTC epoch grid
+    bool sessionAligned() const {
+        return !timezone.empty() || sessionOffset != 0;
+    }
+
+    // All bar durations to generate, sorted ascending and deduplicated.
+    // Only time bars can be rolled up, other bar types produce one series.
+    std::vector<int64_t> timeframes() const {
+        if (barType != BarType::Time) {
+            return {duration};
+        }
+        std::vector<int64_t> result = durations;
+        result.push_back(duration);
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+        return result;
+    }
 };
 
 struct ProcessConfig {
     std::string inputDir;
     std::string outputDir;
     int threadCount;
+    int footprintThreadCount;  // Threads building bars within a single file
     
     ProcessConfig()
         : threadCount(4)  // Default thread count
+        , footprintThreadCount(1)
     {}
 };
 
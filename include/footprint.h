@@ -1,7 +1,8 @@
 #pragma once
 #include "trade.h"
+#include "precision.h"
 #include "json.hpp"
-#include <map>
+#include <vector>
 #include <string>
 #include <cmath>
 
@@ -10,34 +11,87 @@ namespace trading {
 class FootprintBar {
 public:
     struct PriceLevel {
+        int64_t level{0};  // price level index
         double price{0.0};
-        double volume{0.0};
-        double bidSize{0.0};
-        double askSize{0.0};
+        // 成交量类字段均以lot为单位，见 toLots()
+        int64_t volume{0};
+        int64_t bidSize{0};
+        int64_t askSize{0};
         int bidCount{0};
         int askCount{0};
-        double delta{0.0};
+        int64_t delta{0};
         int tradesCount{0};
-        int volumePrecision{0};
-        int pricePrecision{0};
+        bool buyImbalance{false};   // askSize vs bidSize one level below, false if that level has no trades
+        bool sellImbalance{false};  // bidSize vs askSize one level above, false if that level has no trades
+        int largeBidCount{0};
+        int largeAskCount{0};
+        int64_t largeBidSize{0};
+        int64_t largeAskSize{0};
 
-        PriceLevel(int vp = 0, int pp = 0)
-            : volumePrecision(vp), pricePrecision(pp) {}
+        nlohmann::json toJsonObject(const RuntimePrecision& precision) const;
+        // 累加同一档位的成交计数和成交量，失衡标志需重新计算
+        void add(const PriceLevel& other);
+    };
+
+    struct LargeTrade {
+        int64_t time{0};
+        double price{0.0};
+        int64_t size{0};  // lots
+        bool isBuy{false};
+
+        // 成交量大的在前，相同时更早的在前
+        static bool larger(const LargeTrade& a, const LargeTrade& b) {
+            return a.size != b.size ? a.size > b.size : a.time < b.time;
+        }
+    };
 
-        std::string toJson() const;
+    struct StackedImbalance {
+        bool buy{false};
+        double low{0.0};
+        double high{0.0};
+        int levels{0};
     };
 
     FootprintBar(int duration = 0, int scale = 0,
-                int volumePrecision = 0, int pricePrecision = 0);
+                int volumePrecision = 0, int pricePrecision = 0,
+                int lotPrecision = kDefaultLotPrecision);
 
-    bool handleTick(const Trade& tick);
-    void endHandleTick();
-    std::string toJson() const;
+    // 本K线的价格、成交量和lot精度
+    RuntimePrecision runtimePrecision() const {
+        return RuntimePrecision(pricePrecision, volumePrecision, scale, lotPrecision);
+    }
+
+    // fillEmptyLevels 为true时补齐开盘到收盘之间没有成交的空档位
+    std::string toJson(bool fillEmptyLevels = false) const;
+    // 与 toJson 相同的字段，直接放入上层JSON文档，省去序列化再解析
+    nlohmann::json toJsonObject(bool fillEmptyLevels = false) const;
+    // 无成交时间段的占位K线：OHLC及各价格字段取 previous 的收盘价，成交量为零，
+    // 累计delta延续 previous，session内的累计值仅在 sameSession 时延续。
+    // 与普通K线经同一个 toJsonObject 输出，字段保持一致
+    static FootprintBar placeholder(const FootprintBar& previous, int64_t timestamp,
+                                    bool sameSession);
+    // 计算成交量最大档位(POC)及包含 valueAreaPercent 成交量的价值区间
+    void computeValueArea(double valueAreaPercent);
+    // 标记对角买卖失衡档位，并找出连续 minStacked 档以上的堆叠失衡
+    void computeImbalances(double ratio, int minStacked);
+    // 由累加值计算VWAP、TWAP和成交量加权标准差
+    void computeAverages();
+    // 档位高度放大 factor 倍并重新归档，派生字段需重新计算
+    void coarsen(int factor);
+    // 合并同一时间段内更晚的部分K线，派生字段需重新计算，topTrades 需由调用方截断
+    void merge(const FootprintBar& later);
+    // merge 和细周期合并共用：合并 later 的OHLC、成交量、大单阈值和可合并累加值，
+    // 不含档位和 topTrades，两者的档位存储不同
+    void mergeTotals(const FootprintBar& later);
+
+    // 无损的状态序列化，只包含原始累加值
+    nlohmann::json toState() const;
+    static FootprintBar fromState(const nlohmann::json& state);
 
     int64_t timestamp{0};
     int duration{0};
     int scale{0};
-    std::map<double, PriceLevel> priceLevels;
+    std::vector<PriceLevel> priceLevels;  // sorted by price level index, traded levels only
 
     int64_t openTime{0};
     int64_t closeTime{0};
@@ -45,18 +99,58 @@ public:
     double high{0.0};
     double low{0.0};
     double close{0.0};
-    double volume{0.0};
-    double delta{0.0};
+    int64_t volume{0};  // lots
+    int64_t delta{0};   // lots
     int tradesCount{0};
     int volumePrecision{0};
     int pricePrecision{0};
+    int lotPrecision{kDefaultLotPrecision};
+
+    double poc{0.0};  // point of control
+    double vah{0.0};  // value area high
+    double val{0.0};  // value area low
+    std::vector<StackedImbalance> stackedImbalances;
+
+    int64_t largeThreshold{0};  // 计为大单的最小成交量(lot)，0表示未启用
+    std::vector<LargeTrade> topTrades;  // sorted by size descending
 
-private:
-    double priceLevelHeight{0.0};
+    // 可合并的累加值：sum(price * lots)、sum(price^2 * lots)、逐笔的 sum(lots^2)，
+    // 以及按秒加权的价格和，每秒的价格取该秒第一笔成交价并延续到下一笔成交所在的秒，
+    // 不含收盘所在的一秒
+    double priceVolume{0.0};
+    double priceSqVolume{0.0};
+    double sizeSqLots{0.0};
+    double timePrice{0.0};
+    // 开盘所在一秒的价格在 timePrice 中延续的秒数，尚未成交到下一秒时为0。
+    // 同一秒的成交被拆到两段时，用于把后一段按自己开盘价计入的部分换成前一段的价格
+    int64_t openSpan{0};
+
+    double vwap{0.0};
+    double twap{0.0};
+    double stddev{0.0};  // volume weighted standard deviation of price
+
+    int64_t cumulativeDelta{0};  // 跨K线和文件的累计delta(lot)
+    int64_t sessionDelta{0};     // 当前session内的累计delta(lot)
+    double sessionVwap{0.0};      // 当前session开始以来的VWAP
+    double sessionStddev{0.0};    // 当前session的成交量加权标准差，VWAP带为 sessionVwap ± k * sessionStddev
+};
+
+// 最细周期K线形成过程中的快照。levels 只包含自同一K线上一个快照以来有变化的档位，
+// 取值为该档位的当前累计值；每根K线的第一个快照(seq为0)包含此前的全部档位
+struct BarSnapshot {
+    int64_t barTimestamp{0};
+    int64_t time{0};  // 快照时刻，此前的成交均已计入
+    int seq{0};
+    double open{0.0};
+    double high{0.0};
+    double low{0.0};
+    double close{0.0};
+    int64_t volume{0};  // lots
+    int64_t delta{0};   // lots
+    int tradesCount{0};
+    std::vector<FootprintBar::PriceLevel> levels;
 
-    double getPriceLevelHeight();
-    double normalizePrice(double price);
-    void fillNoTradesPriceLevels();
+    std::string toJson(const RuntimePrecision& precision) const;
 };
 
-} // namespace trading 
\ No newline at end of file
+} // namespace trading
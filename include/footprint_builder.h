@@ -0,0 +1,638 @@
+#pragma once
+#include "aggregator.h"
+#include "bar_policy.h"
+#include "config.h"
+#include "footprint.h"
+#include "precision.h"
+#include "trade.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace trading {
+
+// 按精度和收线策略特化的K线构建器，Precision 为 RuntimePrecision 或
+// StaticPrecision<...>，ClosePolicy 见 bar_policy.h
+template <typename Precision, typename ClosePolicy = TimeBarPolicy>
+class FootprintBuilder {
+public:
+    explicit FootprintBuilder(const SymbolConfig& config)
+        : config_(config)
+        , precision_(config)
+        , policy_(config)
+        , bar_(makeBar())
+        , largeTradeLots_(precision_.toLots(config.largeTradeSize))
+        , levels_(kInitialLevels)
+        , occupied_(kInitialLevels / 64) {}
+
+    // 成交不属于当前K线时返回false
+    bool handleTick(const Trade& tick);
+    // 细粒度K线不属于当前K线时返回false
+    bool handleBar(const FootprintBar& bar);
+    void endHandleTick();
+
+    // 启用后按 snapshotInterval / snapshotTrades 把形成中的K线快照追加到 snapshots
+    void setSnapshotOutput(std::vector<BarSnapshot>* snapshots) {
+        snapshots_ = snapshots;
+        dirty_.assign(levels_.size() / 64, 0);
+    }
+
+    bool empty() const { return bar_.timestamp == 0; }
+    FootprintBar& bar() { return bar_; }
+    // 清空档位缓冲区以复用于下一根K线，不释放内存
+    void reset();
+
+private:
+    static constexpr size_t kInitialLevels = 256;
+
+    SymbolConfig config_;
+    Precision precision_;
+    ClosePolicy policy_;
+    FootprintBar bar_;
+    int64_t largeTradeLots_;  // 绝对大单阈值，0表示未启用
+
+    // 稠密档位缓冲区，levels_[i] 对应档位 baseLevel_ + i；
+    // [minLevel_, maxLevel_] 之外的元素始终为零。
+    // occupied_ 的第 i 位标记 levels_[i] 有成交，收线时只按位图取出有成交的档位
+    std::vector<FootprintBar::PriceLevel> levels_;
+    std::vector<uint64_t> occupied_;
+    int64_t baseLevel_{0};
+    int64_t minLevel_{0};
+    int64_t maxLevel_{-1};
+
+    // 按百分位判定大单时，收线前无法确定阈值，先记录本K线每笔成交
+    struct SizedTrade {
+        int64_t size;  // lots
+        int64_t level;
+        bool isBuy;
+    };
+    std::vector<SizedTrade> sizedTrades_;
+    // 最大的 topTradeCount 笔成交，以 LargeTrade::larger 为序的堆，堆顶为其中最小的一笔
+    std::vector<FootprintBar::LargeTrade> topTrades_;
+
+    // 快照输出，dirty_ 与 occupied_ 布局相同，标记自上一个快照以来有变化的档位
+    std::vector<BarSnapshot>* snapshots_{nullptr};
+    std::vector<uint64_t> dirty_;
+    int64_t nextSnapshotTime_{0};
+    int snapshotSeq_{0};
+
+    FootprintBar makeBar() const {
+        return FootprintBar(ClosePolicy::kTimeBased ? config_.duration : 0, config_.scale,
+                            config_.volumePrecision, config_.pricePrecision,
+                            config_.lotPrecision);
+    }
+
+    FootprintBar::PriceLevel& getPriceLevel(int64_t level) {
+        if (level < minLevel_ || level > maxLevel_) {
+            expandLevels(level);
+        }
+        size_t index = static_cast<size_t>(level - baseLevel_);
+        occupied_[index / 64] |= uint64_t{1} << (index % 64);
+        if (snapshots_ != nullptr) {
+            dirty_[index / 64] |= uint64_t{1} << (index % 64);
+        }
+        return levels_[index];
+    }
+
+    static void addLargeTrade(FootprintBar::PriceLevel& priceLevel, int64_t size, bool isBuy) {
+        if (isBuy) {
+            priceLevel.largeAskCount++;
+            priceLevel.largeAskSize += size;
+        } else {
+            priceLevel.largeBidCount++;
+            priceLevel.largeBidSize += size;
+        }
+    }
+
+    void pushTopTrade(const FootprintBar::LargeTrade& trade);
+    void takeSnapshot(int64_t time);
+    void classifyLargeTrades();
+    void expandLevels(int64_t level);
+    void collectPriceLevels();
+};
+
+template <typename Precision, typename ClosePolicy>
+void FootprintBuilder<Precision, ClosePolicy>::expandLevels(int64_t level) {
+    if (minLevel_ > maxLevel_) {
+        // 新K线的第一个档位，放在缓冲区中间
+        baseLevel_ = level - static_cast<int64_t>(levels_.size() / 2);
+        minLevel_ = maxLevel_ = level;
+        return;
+    }
+
+    int64_t newMin = std::min(minLevel_, level);
+    int64_t newMax = std::max(maxLevel_, level);
+    if (newMin >= baseLevel_ && newMax < baseLevel_ + static_cast<int64_t>(levels_.size())) {
+        minLevel_ = newMin;
+        maxLevel_ = newMax;
+        return;
+    }
+
+    // 超出缓冲区范围，扩容并重新居中
+    size_t span = static_cast<size_t>(newMax - newMin + 1);
+    size_t newSize = (std::max(levels_.size() * 2, span * 2) + 63) / 64 * 64;
+    int64_t newBase = newMin - static_cast<int64_t>((newSize - span) / 2);
+    std::vector<FootprintBar::PriceLevel> expanded(newSize);
+    std::vector<uint64_t> occupied(newSize / 64);
+    std::vector<uint64_t> dirty(snapshots_ != nullptr ? newSize / 64 : 0);
+    for (int64_t i = minLevel_; i <= maxLevel_; ++i) {
+        const auto& priceLevel = levels_[i - baseLevel_];
+        if (priceLevel.tradesCount == 0) continue;
+        size_t oldIndex = static_cast<size_t>(i - baseLevel_);
+        size_t index = static_cast<size_t>(i - newBase);
+        expanded[index] = priceLevel;
+        occupied[index / 64] |= uint64_t{1} << (index % 64);
+        if (snapshots_ != nullptr && (dirty_[oldIndex / 64] >> (oldIndex % 64) & 1) != 0) {
+            dirty[index / 64] |= uint64_t{1} << (index % 64);
+        }
+    }
+    levels_.swap(expanded);
+    occupied_.swap(occupied);
+    dirty_.swap(dirty);
+    baseLevel_ = newBase;
+    minLevel_ = newMin;
+    maxLevel_ = newMax;
+}
+
+template <typename Precision, typename ClosePolicy>
+void FootprintBuilder<Precision, ClosePolicy>::reset() {
+    if (minLevel_ <= maxLevel_) {
+        std::fill(levels_.begin() + (minLevel_ - baseLevel_),
+                  levels_.begin() + (maxLevel_ - baseLevel_ + 1),
+                  FootprintBar::PriceLevel{});
+        std::fill(occupied_.begin() + (minLevel_ - baseLevel_) / 64,
+                  occupied_.begin() + (maxLevel_ - baseLevel_) / 64 + 1,
+                  uint64_t{0});
+        if (snapshots_ != nullptr) {
+            std::fill(dirty_.begin() + (minLevel_ - baseLevel_) / 64,
+                      dirty_.begin() + (maxLevel_ - baseLevel_) / 64 + 1,
+                      uint64_t{0});
+        }
+    }
+    snapshotSeq_ = 0;
+    minLevel_ = 0;
+    maxLevel_ = -1;
+    sizedTrades_.clear();
+    topTrades_.clear();
+    bar_ = makeBar();
+}
+
+template <typename Precision, typename ClosePolicy>
+void FootprintBuilder<Precision, ClosePolicy>::pushTopTrade(const FootprintBar::LargeTrade& trade) {
+    auto limit = static_cast<size_t>(config_.topTradeCount);
+    if (topTrades_.size() < limit) {
+        topTrades_.push_back(trade);
+        std::push_heap(topTrades_.begin(), topTrades_.end(), &FootprintBar::LargeTrade::larger);
+    } else if (FootprintBar::LargeTrade::larger(trade, topTrades_.front())) {
+        std::pop_heap(topTrades_.begin(), topTrades_.end(), &FootprintBar::LargeTrade::larger);
+        topTrades_.back() = trade;
+        std::push_heap(topTrades_.begin(), topTrades_.end(), &FootprintBar::LargeTrade::larger);
+    }
+}
+
+template <typename Precision, typename ClosePolicy>
+void FootprintBuilder<Precision, ClosePolicy>::takeSnapshot(int64_t time) {
+    BarSnapshot snapshot;
+    snapshot.barTimestamp = bar_.timestamp;
+    snapshot.time = time;
+    snapshot.seq = snapshotSeq_++;
+    snapshot.open = bar_.open;
+    snapshot.high = bar_.high;
+    snapshot.low = bar_.low;
+    snapshot.close = bar_.close;
+    snapshot.volume = bar_.volume;
+    snapshot.delta = bar_.delta;
+    snapshot.tradesCount = bar_.tradesCount;
+
+    size_t firstWord = static_cast<size_t>(minLevel_ - baseLevel_) / 64;
+    size_t lastWord = static_cast<size_t>(maxLevel_ - baseLevel_) / 64;
+    for (size_t word = firstWord; word <= lastWord; ++word) {
+        for (uint64_t bits = dirty_[word]; bits != 0; bits &= bits - 1) {
+            size_t index = word * 64 + static_cast<size_t>(std::countr_zero(bits));
+            int64_t level = baseLevel_ + static_cast<int64_t>(index);
+            snapshot.levels.push_back(levels_[index]);
+            snapshot.levels.back().level = level;
+            snapshot.levels.back().price = precision_.levelToPrice(level);
+        }
+        dirty_[word] = 0;
+    }
+    snapshots_->push_back(std::move(snapshot));
+}
+
+template <typename Precision, typename ClosePolicy>
+void FootprintBuilder<Precision, ClosePolicy>::classifyLargeTrades() {
+    if (sizedTrades_.empty()) {
+        return;
+    }
+    // 本K线成交量的百分位作为阈值，只遍历本K线的成交记录
+    size_t rank = static_cast<size_t>(config_.largeTradePercentile *
+                                      static_cast<double>(sizedTrades_.size() - 1));
+    rank = std::min(rank, sizedTrades_.size() - 1);
+    std::nth_element(sizedTrades_.begin(), sizedTrades_.begin() + rank, sizedTrades_.end(),
+                     [](const SizedTrade& a, const SizedTrade& b) { return a.size < b.size; });
+    bar_.largeThreshold = sizedTrades_[rank].size;
+    for (const auto& trade : sizedTrades_) {
+        if (trade.size >= bar_.largeThreshold) {
+            addLargeTrade(levels_[trade.level - baseLevel_], trade.size, trade.isBuy);
+        }
+    }
+}
+
+template <typename Precision, typename ClosePolicy>
+bool FootprintBuilder<Precision, ClosePolicy>::handleTick(const Trade& tick) {
+    if (bar_.timestamp == 0) {
+        bar_.timestamp = policy_.open(tick);
+        bar_.openTime = tick.time;
+        bar_.closeTime = tick.time;
+        // OHLC都取成交价，保证开盘价落在高低点之间，由细周期合并出的粗周期与直接构建一致
+        bar_.open = tick.price;
+        bar_.close = tick.price;
+        bar_.high = tick.price;
+        bar_.low = tick.price;
+    }
+
+    if (!policy_.accepts(bar_, tick)) {
+        return false;
+    }
+
+    // 按时间的快照记录跨过间隔边界之前的状态
+    if (snapshots_ != nullptr && config_.snapshotInterval > 0) {
+        if (bar_.tradesCount > 0 && tick.time >= nextSnapshotTime_) {
+            takeSnapshot(nextSnapshotTime_);
+        }
+        nextSnapshotTime_ = (tick.time / config_.snapshotInterval + 1) * config_.snapshotInterval;
+    }
+
+    int64_t level = precision_.priceToLevel(tick.price);
+    auto& priceLevel = getPriceLevel(level);
+
+    if (tick.time > bar_.closeTime) {
+        if (bar_.closeTime == bar_.openTime) {
+            bar_.openSpan = tick.time - bar_.closeTime;
+        }
+        bar_.timePrice += bar_.close * static_cast<double>(tick.time - bar_.closeTime);
+        bar_.closeTime = tick.time;
+        bar_.close = tick.price;
+    }
+
+    if (tick.time < bar_.openTime) {
+        bar_.openTime = tick.time;
+        bar_.open = tick.price;
+    }
+
+    bar_.high = std::max(bar_.high, tick.price);
+    bar_.low = std::min(bar_.low, tick.price);
+
+    if (tick.isBuy) {
+        priceLevel.askSize += tick.lots;
+        priceLevel.askCount++;
+        priceLevel.delta += tick.lots;
+    } else {
+        priceLevel.bidSize += tick.lots;
+        priceLevel.bidCount++;
+        priceLevel.delta -= tick.lots;
+    }
+
+    priceLevel.volume += tick.lots;
+    priceLevel.tradesCount++;
+
+    if (config_.largeTradePercentile > 0.0) {
+        sizedTrades_.push_back({tick.lots, level, tick.isBuy});
+    } else if (largeTradeLots_ > 0 && tick.lots >= largeTradeLots_) {
+        bar_.largeThreshold = largeTradeLots_;
+        addLargeTrade(priceLevel, tick.lots, tick.isBuy);
+    }
+    if (config_.topTradeCount > 0) {
+        pushTopTrade({tick.time, tick.price, tick.lots, tick.isBuy});
+    }
+
+    bar_.volume += tick.lots;
+    double lots = static_cast<double>(tick.lots);
+    bar_.priceVolume += tick.price * lots;
+    bar_.priceSqVolume += tick.price * tick.price * lots;
+    bar_.sizeSqLots += lots * lots;
+    bar_.tradesCount++;
+    bar_.delta += tick.isBuy ? tick.lots : -tick.lots;
+    policy_.update(tick);
+
+    if (snapshots_ != nullptr && config_.snapshotTrades > 0 &&
+        bar_.tradesCount % config_.snapshotTrades == 0) {
+        takeSnapshot(tick.time);
+    }
+    return true;
+}
+
+template <typename Precision, typename ClosePolicy>
+bool FootprintBuilder<Precision, ClosePolicy>::handleBar(const FootprintBar& bar) {
+    if (bar_.timestamp == 0) {
+        bar_.timestamp = policy_.openAt(bar.timestamp);
+        bar_.openTime = bar.openTime;
+        bar_.closeTime = bar.closeTime;
+        bar_.open = bar.open;
+        bar_.close = bar.close;
+        bar_.high = bar.high;
+        bar_.low = bar.low;
+        bar_.openSpan = bar.openSpan;
+    }
+
+    if (bar.timestamp < bar_.timestamp || bar.timestamp >= policy_.end) {
+        return false;
+    }
+
+    // 合并规则与跨文件拼接同一根K线时的 FootprintBar::merge 相同
+    bar_.mergeTotals(bar);
+    for (const auto& level : bar.priceLevels) {
+        if (level.tradesCount == 0) continue;
+        getPriceLevel(level.level).add(level);
+    }
+    for (const auto& trade : bar.topTrades) {
+        pushTopTrade(trade);
+    }
+    return true;
+}
+
+template <typename Precision, typename ClosePolicy>
+void FootprintBuilder<Precision, ClosePolicy>::collectPriceLevels() {
+    // 只输出有成交的档位，空档位由输出端按需补齐
+    auto& priceLevels = bar_.priceLevels;
+    priceLevels.clear();
+    if (minLevel_ > maxLevel_) {
+        return;
+    }
+    size_t firstWord = static_cast<size_t>(minLevel_ - baseLevel_) / 64;
+    size_t lastWord = static_cast<size_t>(maxLevel_ - baseLevel_) / 64;
+    size_t count = 0;
+    for (size_t word = firstWord; word <= lastWord; ++word) {
+        count += static_cast<size_t>(std::popcount(occupied_[word]));
+    }
+    priceLevels.reserve(count);
+    for (size_t word = firstWord; word <= lastWord; ++word) {
+        for (uint64_t bits = occupied_[word]; bits != 0; bits &= bits - 1) {
+            size_t index = word * 64 + static_cast<size_t>(std::countr_zero(bits));
+            int64_t level = baseLevel_ + static_cast<int64_t>(index);
+            priceLevels.push_back(levels_[index]);
+            priceLevels.back().level = level;
+            priceLevels.back().price = precision_.levelToPrice(level);
+        }
+    }
+}
+
+template <typename Precision, typename ClosePolicy>
+void FootprintBuilder<Precision, ClosePolicy>::endHandleTick() {
+    classifyLargeTrades();
+    collectPriceLevels();
+    bar_.computeAverages();
+    bar_.topTrades.assign(topTrades_.begin(), topTrades_.end());
+    std::sort(bar_.topTrades.begin(), bar_.topTrades.end(), &FootprintBar::LargeTrade::larger);
+    bar_.computeValueArea(config_.valueAreaPercent);
+    bar_.computeImbalances(config_.imbalanceRatio, config_.stackedImbalanceLevels);
+}
+
+// 逐笔输入K线构建器，K线结束时移动到输出并复用构建器。
+// 同时满足聚合器接口，可与其他聚合器在同一次遍历中运行
+template <typename Precision, typename ClosePolicy>
+class FootprintAggregator {
+public:
+    explicit FootprintAggregator(const SymbolConfig& config,
+                                 std::vector<BarSnapshot>* snapshots = nullptr)
+        : builder_(config) {
+        builder_.setSnapshotOutput(snapshots);
+    }
+
+    // 成交或细周期K线
+    template <typename Input>
+    void add(const Input& input) {
+        if (!handle(input)) {
+            // 当前K线结束，移动到输出并复用构建器
+            builder_.endHandleTick();
+            bars_.push_back(std::move(builder_.bar()));
+
+            // 创建新的K线
+            builder_.reset();
+
+            if (!handle(input)) {
+                std::cerr << "Failed to handle trade in new bar" << std::endl;
+            }
+        }
+    }
+
+    void onTrade(const Trade& tick) { add(tick); }
+
+    // 处理最后一个K线
+    void onFlush() {
+        if (!builder_.empty()) {
+            builder_.endHandleTick();
+            bars_.push_back(std::move(builder_.bar()));
+            builder_.reset();
+        }
+    }
+
+    std::vector<FootprintBar>& bars() { return bars_; }
+
+private:
+    FootprintBuilder<Precision, ClosePolicy> builder_;
+    std::vector<FootprintBar> bars_;
+
+    bool handle(const Trade& tick) { return builder_.handleTick(tick); }
+    bool handle(const FootprintBar& bar) { return builder_.handleBar(bar); }
+};
+
+// 由成交或细周期K线构建K线，extras 为与K线构建同一次遍历成交的其他聚合器
+template <typename Precision, typename ClosePolicy, typename Input, typename... Extras>
+std::vector<FootprintBar> buildBars(std::span<const Input> inputs,
+                                    const SymbolConfig& config,
+                                    std::vector<BarSnapshot>* snapshots,
+                                    Extras&... extras) {
+    if (inputs.empty()) {
+        return {};
+    }
+    FootprintAggregator<Precision, ClosePolicy> footprint(config, snapshots);
+
+    // 按时间跨度预留K线数量，避免输出扩容时搬移
+    if constexpr (ClosePolicy::kTimeBased) {
+        int64_t span;
+        if constexpr (std::is_same_v<Input, Trade>) {
+            span = inputs.back().time - inputs.front().time;
+        } else {
+            span = inputs.back().timestamp - inputs.front().timestamp;
+        }
+        footprint.bars().reserve(static_cast<size_t>(span / config.duration + 1));
+    }
+
+    if constexpr (std::is_same_v<Input, Trade>) {
+        runAggregators(inputs, footprint, extras...);
+    } else {
+        static_assert(sizeof...(Extras) == 0, "Extra aggregators need trade input");
+        for (const auto& input : inputs) {
+            footprint.add(input);
+        }
+        footprint.onFlush();
+    }
+    return std::move(footprint.bars());
+}
+
+template <typename Precision, typename ClosePolicy, typename Input>
+std::vector<FootprintBar> buildBars(std::span<const Input> inputs, const SymbolConfig& config) {
+    return buildBars<Precision, ClosePolicy, Input>(inputs, config, nullptr);
+}
+
+// 在K线边界处把有序成交切分为至多threadCount段，各线程独立构建后按序拼接，
+// 结果与单线程构建完全一致。非时间K线依赖之前的全部成交，只能串行构建。
+// aggTrades 非空时在同一次遍历中生成聚合成交
+template <typename Precision, typename ClosePolicy>
+std::vector<FootprintBar> buildBarsParallel(std::span<const Trade> trades,
+                                            const SymbolConfig& config,
+                                            int threadCount,
+                                            std::vector<BarSnapshot>* snapshots,
+                                            std::vector<AggTrade>* aggTrades) {
+    constexpr size_t kMinTradesPerThread = 100000;
+    size_t parts = std::min(static_cast<size_t>(std::max(threadCount, 1)),
+                            trades.size() / kMinTradesPerThread);
+    if (!ClosePolicy::kTimeBased || parts <= 1) {
+        if (aggTrades == nullptr) {
+            return buildBars<Precision, ClosePolicy>(trades, config, snapshots);
+        }
+        AggTradeAggregator aggregator(config);
+        auto bars = buildBars<Precision, ClosePolicy>(trades, config, snapshots, aggregator);
+        *aggTrades = std::move(aggregator.aggregated());
+        return bars;
+    }
+
+    // 取等分点所在K线的下一个边界，二分查找第一笔不早于该边界的成交
+    std::vector<size_t> splits{0};
+    TimeBarPolicy boundaries(config);
+    for (size_t k = 1; k < parts; ++k) {
+        const Trade& pivot = trades[k * trades.size() / parts];
+        boundaries.openAt(pivot.time);
+        int64_t boundary = boundaries.end;
+        auto it = std::lower_bound(trades.begin() + splits.back(), trades.end(), boundary,
+                                   [](const Trade& trade, int64_t time) {
+                                       return trade.time < time;
+                                   });
+        splits.push_back(static_cast<size_t>(it - trades.begin()));
+    }
+    splits.push_back(trades.size());
+
+    // 聚合窗口不跨K线边界时各段独立聚合，否则单独一个线程遍历全部成交。
+    // session对齐的边界只保证落在整秒上
+    int64_t boundaryStep = config.sessionAligned() ? 1 : config.duration;
+    bool splitAggTrades = aggTrades != nullptr &&
+                          boundaryStep * 1000 % config.preAggDuration == 0;
+
+    std::vector<std::vector<FootprintBar>> partials(parts);
+    std::vector<std::vector<BarSnapshot>> partialSnapshots(parts);
+    std::vector<std::vector<AggTrade>> partialAggTrades(parts);
+    std::vector<std::thread> threads;
+    for (size_t k = 0; k < parts; ++k) {
+        threads.emplace_back([&, k]() {
+            auto chunk = trades.subspan(splits[k], splits[k + 1] - splits[k]);
+            auto* chunkSnapshots = snapshots != nullptr ? &partialSnapshots[k] : nullptr;
+            if (!splitAggTrades) {
+                partials[k] = buildBars<Precision, ClosePolicy>(chunk, config, chunkSnapshots);
+                return;
+            }
+            AggTradeAggregator aggregator(config);
+            partials[k] = buildBars<Precision, ClosePolicy>(chunk, config, chunkSnapshots,
+                                                            aggregator);
+            partialAggTrades[k] = std::move(aggregator.aggregated());
+        });
+    }
+    if (aggTrades != nullptr && !splitAggTrades) {
+        threads.emplace_back([&]() {
+            AggTradeAggregator aggregator(config);
+            runAggregators(trades, aggregator);
+            *aggTrades = std::move(aggregator.aggregated());
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    size_t total = 0;
+    for (const auto& partial : partials) {
+        total += partial.size();
+    }
+    std::vector<FootprintBar> footprintList;
+    footprintList.reserve(total);
+    for (auto& partial : partials) {
+        std::move(partial.begin(), partial.end(), std::back_inserter(footprintList));
+    }
+    if (snapshots != nullptr) {
+        for (auto& partial : partialSnapshots) {
+            std::move(partial.begin(), partial.end(), std::back_inserter(*snapshots));
+        }
+    }
+    if (splitAggTrades) {
+        for (auto& partial : partialAggTrades) {
+            std::move(partial.begin(), partial.end(), std::back_inserter(*aggTrades));
+        }
+    }
+    return footprintList;
+}
+
+// 一次遍历生成 config.timeframes() 中的所有周期：最细周期由成交构建，
+// 较粗周期由能整除它的最粗已有周期合并价格档位得到。
+// snapshots 非空时同时记录最细周期K线形成过程中的快照，
+// aggTrades 非空时在构建最细周期的同一次遍历中生成聚合成交
+template <typename Precision, typename ClosePolicy>
+std::vector<std::vector<FootprintBar>> buildFootprint(const std::vector<Trade>& trades,
+                                                      const SymbolConfig& config,
+                                                      int threadCount,
+                                                      std::vector<BarSnapshot>* snapshots,
+                                                      std::vector<AggTrade>* aggTrades) {
+    auto timeframes = config.timeframes();
+    std::vector<std::vector<FootprintBar>> result;
+    result.reserve(timeframes.size());
+
+    SymbolConfig frameConfig = config;
+    frameConfig.duration = timeframes.front();
+    result.push_back(buildBarsParallel<Precision, ClosePolicy>(trades, frameConfig, threadCount,
+                                                               snapshots, aggTrades));
+
+    for (size_t i = 1; i < timeframes.size(); ++i) {
+        size_t source = i - 1;
+        while (source > 0 && timeframes[i] % timeframes[source] != 0) {
+            --source;
+        }
+        if (timeframes[i] % timeframes[source] != 0) {
+            throw std::runtime_error("Duration " + std::to_string(timeframes[i]) +
+                                     " is not a multiple of " +
+                                     std::to_string(timeframes.front()));
+        }
+        frameConfig.duration = timeframes[i];
+        result.push_back(buildBars<Precision, TimeBarPolicy>(
+            std::span<const FootprintBar>(result[source]), frameConfig));
+    }
+
+    return result;
+}
+
+using FootprintGenerator = std::vector<std::vector<FootprintBar>> (*)(
+    const std::vector<Trade>&, const SymbolConfig&, int threadCount,
+    std::vector<BarSnapshot>* snapshots, std::vector<AggTrade>* aggTrades);
+
+template <typename Precision>
+FootprintGenerator selectBarPolicy(BarType barType) {
+    switch (barType) {
+        case BarType::Time:   return &buildFootprint<Precision, TimeBarPolicy>;
+        case BarType::Volume: return &buildFootprint<Precision, VolumeBarPolicy>;
+        case BarType::Tick:   return &buildFootprint<Precision, TickBarPolicy>;
+        case BarType::Dollar: return &buildFootprint<Precision, DollarBarPolicy>;
+        case BarType::Range:  return &buildFootprint<Precision, RangeBarPolicy>;
+        case BarType::Renko:  return &buildFootprint<Precision, RenkoBarPolicy>;
+    }
+    throw std::runtime_error("Unsupported bar type");
+}
+
+// 常用精度组合走编译期特化版本，其余回退到运行时精度；再按收线策略选择实例
+FootprintGenerator selectFootprintGenerator(const SymbolConfig& config);
+
+} // namespace trading
@@ -0,0 +1,21 @@
+#pragma once
+#include "footprint.h"
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace trading {
+
+// 时间×价格的delta热力图张量，供模型训练直接读取。
+// 文件头为魔数"FPHM"、uint64 K线数、uint32 档位数和uint32 通道数，
+// 之后为int64 K线时间戳列，最后为 [bars x levels x channels] 的float32数组，按行优先连续存放。
+// 每根K线取以收盘价档位为中心的 levels 个档位，第 levels/2 行为收盘价档位，
+// 档位从低到高排列，通道依次为 bidSize、askSize、delta、tradesCount，成交量以币为单位。
+// 只包含有成交的K线，fillGaps 的占位K线不在其中，按时间戳列对齐
+constexpr int kHeatmapChannels = 4;
+
+void writeHeatmapTensor(std::ostream& out, const std::vector<FootprintBar>& bars, int levels);
+void writeHeatmapTensor(const std::string& filename, const std::vector<FootprintBar>& bars,
+                        int levels);
+
+} // namespace trading
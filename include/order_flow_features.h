@@ -0,0 +1,50 @@
+#pragma once
+#include "footprint.h"
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace trading {
+
+// 每根K线固定长度的订单流特征，由档位数组计算，成交量类特征以币为单位
+enum OrderFlowFeature : size_t {
+    kFeatureVolume,
+    kFeatureDelta,
+    kFeatureDeltaRatio,          // delta / volume
+    kFeatureBuyImbalanceShare,   // 买方失衡档位占有成交档位的比例
+    kFeatureSellImbalanceShare,
+    kFeatureStackedImbalances,   // 堆叠失衡数量
+    kFeatureDeltaSkew,           // 主动买量重心减主动卖量重心，以K线价格区间归一化到[-1, 1]
+    kFeatureVolumeConcentration, // 各档成交量占比的平方和(HHI)
+    kFeaturePocShare,            // POC档位成交量占比
+    kFeatureTopDelta,            // 价格区间上三分之一档位的delta
+    kFeatureBottomDelta,         // 价格区间下三分之一档位的delta
+    kFeatureMeanTradeSize,
+    kFeatureTradeSizeStddev,     // 逐笔成交量的标准差
+    kFeatureAskBidSizeRatio,     // 主动买单平均大小 / 主动卖单平均大小
+    kFeatureLargeTradeShare,     // 大单成交量占比
+    kFeatureClosePosition,       // 收盘价在高低点区间中的位置，0为最低
+    kFeatureCount
+};
+
+// 特征列名，与 OrderFlowFeature 顺序一致
+const std::array<const char*, kFeatureCount>& orderFlowFeatureNames();
+
+// 逐根K线计算特征。档位数据先按列展开到复用的连续数组，
+// 再以分道累加的无分支循环归约，编译器可将其向量化
+class OrderFlowExtractor {
+public:
+    void extract(const FootprintBar& bar, float* features);
+
+private:
+    std::vector<double> bid_;
+    std::vector<double> ask_;
+    std::vector<double> position_;  // 档位在K线价格区间中的位置，0为最低档，1为最高档
+};
+
+// 列式特征表：头部为魔数"OFFT"、uint32列数、uint64行数和以'\0'结尾的列名，
+// 之后依次为int64时间戳列和各特征的float32列，每列按行连续存放
+void writeFeatureTable(const std::string& filename, const std::vector<FootprintBar>& bars);
+
+} // namespace trading
@@ -9,9 +9,11 @@ namespace trading {
 class OutputHandler {
 public:
     virtual ~OutputHandler() = default;
+    // previous 为上一个文件最后输出的K线，没有时为空；fillGaps 时从它补齐到本文件第一根K线
     virtual void write(const std::string& filename, 
                       const std::vector<FootprintBar>& bars,
-                      const SymbolConfig& config) = 0;
+                      const SymbolConfig& config,
+                      const FootprintBar* previous) = 0;
     
     static std::unique_ptr<OutputHandler> create(const std::string& format);
 };
@@ -20,14 +22,16 @@ class JsonOutputHandler : public OutputHandler {
 public:
     void write(const std::string& filename,
               const std::vector<FootprintBar>& bars,
-              const SymbolConfig& config) override;
+              const SymbolConfig& config,
+              const FootprintBar* previous) override;
 };
 
 class CsvOutputHandler : public OutputHandler {
 public:
     void write(const std::string& filename,
               const std::vector<FootprintBar>& bars,
-              const SymbolConfig& config) override;
+              const SymbolConfig& config,
+              const FootprintBar* previous) override;
 };
 
 } // namespace trading 
\ No newline at end of file
@@ -0,0 +1,155 @@
+#pragma once
+#include "config.h"
+#include <cstdint>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace trading {
+
+constexpr double powerOf10(int n) {
+    double result = 1.0;
+    for (int i = 0; i < n; ++i) result *= 10.0;
+    for (int i = 0; i > n; --i) result /= 10.0;
+    return result;
+}
+
+// 成交量的定点表示：1 lot = 10^-lotPrecision 个单位，lotPrecision 按品种取交易所的数量步长
+// (SymbolConfig::lotPrecision)。累加使用整数，结果与求和顺序和线程切分无关；
+// 单笔数量和累加值都不能超过int64范围，大发行量代币应使用较小的 lotPrecision
+constexpr int kDefaultLotPrecision = 8;
+
+// 超出int64范围的数量无法表示为lot，抛出异常而不是静默溢出
+inline int64_t toLots(double quantity, double lotsPerUnit) {
+    double lots = std::round(quantity * lotsPerUnit);
+    if (!(std::fabs(lots) < 9.2e18)) {
+        throw std::runtime_error("Quantity " + std::to_string(quantity) +
+                                 " overflows the lot range, lower lotPrecision");
+    }
+    return static_cast<int64_t>(lots);
+}
+
+inline double fromLots(int64_t lots, double lotsPerUnit) {
+    return static_cast<double>(lots) / lotsPerUnit;
+}
+
+// 在整数上按 precision 位小数四舍五入(远离零)，避免 0.145 这类值经double换算后舍错方向
+inline double roundLotsTo(int64_t lots, int lotPrecision, int precision) {
+    if (precision >= lotPrecision) {
+        return static_cast<double>(lots) / powerOf10(lotPrecision);
+    }
+    int64_t unit = static_cast<int64_t>(powerOf10(lotPrecision - precision));
+    int64_t half = unit / 2;
+    int64_t units = (lots >= 0 ? lots + half : lots - half) / unit;
+    return static_cast<double>(units) / powerOf10(precision);
+}
+
+// 价格换算为最小价格单位(tick)的整数时向下取整，与按档位高度floor分档一致；
+// 加上很小的容差，恰好落在tick上的价格不会因 0.57 * 100 = 56.999... 落到下一个tick
+constexpr double kTickTolerance = 1e-6;
+
+inline int64_t priceToTicks(double price, double priceMultiplier) {
+    return static_cast<int64_t>(std::floor(price * priceMultiplier + kTickTolerance));
+}
+
+// 价格/成交量精度和档位高度，运行时版本
+struct RuntimePrecision {
+    int pricePrecision;
+    int volumePrecision;
+    int scale;
+    int lotPrecision;
+    double priceMultiplier;   // 10^pricePrecision，最小价格单位的倒数
+    double volumeMultiplier;  // 10^volumePrecision
+    double lotsPerUnit;       // 10^lotPrecision
+
+    RuntimePrecision(int pricePrecision, int volumePrecision, int scale, int lotPrecision)
+        : pricePrecision(pricePrecision)
+        , volumePrecision(volumePrecision)
+        , scale(scale)
+        , lotPrecision(lotPrecision)
+        , priceMultiplier(powerOf10(pricePrecision))
+        , volumeMultiplier(powerOf10(volumePrecision))
+        , lotsPerUnit(powerOf10(lotPrecision)) {}
+
+    explicit RuntimePrecision(const SymbolConfig& config)
+        : RuntimePrecision(config.pricePrecision, config.volumePrecision, config.scale,
+                           config.lotPrecision) {}
+
+    int64_t priceToLevel(double price) const {
+        // 先转换为最小价格单位的整数，再按scale整除得到档位
+        return priceToTicks(price, priceMultiplier) / scale;
+    }
+
+    double levelToPrice(int64_t level) const {
+        return static_cast<double>(level * scale) / priceMultiplier;
+    }
+
+    double roundPrice(double price) const {
+        return std::round(price * priceMultiplier) / priceMultiplier;
+    }
+
+    double roundVolume(double volume) const {
+        return std::round(volume * volumeMultiplier) / volumeMultiplier;
+    }
+
+    int64_t toLots(double quantity) const {
+        return trading::toLots(quantity, lotsPerUnit);
+    }
+
+    double fromLots(int64_t lots) const {
+        return trading::fromLots(lots, lotsPerUnit);
+    }
+
+    double roundLots(int64_t lots) const {
+        return roundLotsTo(lots, lotPrecision, volumePrecision);
+    }
+};
+
+// 编译期固定价格精度，价格相关的乘除常量在编译期折叠；lot精度按品种在运行时给出
+template <int PricePrecision, int VolumePrecision, int Scale>
+struct StaticPrecision {
+    static_assert(Scale > 0, "Scale must be positive");
+
+    static constexpr int pricePrecision = PricePrecision;
+    static constexpr int volumePrecision = VolumePrecision;
+    static constexpr int scale = Scale;
+    static constexpr double priceMultiplier = powerOf10(PricePrecision);
+    static constexpr double volumeMultiplier = powerOf10(VolumePrecision);
+
+    int lotPrecision;
+    double lotsPerUnit;
+
+    explicit StaticPrecision(const SymbolConfig& config = {})
+        : lotPrecision(config.lotPrecision)
+        , lotsPerUnit(powerOf10(config.lotPrecision)) {}
+
+    static int64_t priceToLevel(double price) {
+        return priceToTicks(price, priceMultiplier) / Scale;
+    }
+
+    static double levelToPrice(int64_t level) {
+        return static_cast<double>(level * Scale) / priceMultiplier;
+    }
+
+    static double roundPrice(double price) {
+        return std::round(price * priceMultiplier) / priceMultiplier;
+    }
+
+    static double roundVolume(double volume) {
+        return std::round(volume * volumeMultiplier) / volumeMultiplier;
+    }
+
+    int64_t toLots(double quantity) const {
+        return trading::toLots(quantity, lotsPerUnit);
+    }
+
+    double fromLots(int64_t lots) const {
+        return trading::fromLots(lots, lotsPerUnit);
+    }
+
+    double roundLots(int64_t lots) const {
+        return roundLotsTo(lots, lotPrecision, VolumePrecision);
+    }
+};
+
+} // namespace trading
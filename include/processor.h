@@ -3,9 +3,15 @@
 #include "data_fetcher.h"
 #include "output_handler.h"
 #include "footprint.h"
+#include "footprint_builder.h"
+#include "symbol_registry.h"
+#include "volume_profile.h"
 #include <string>
 #include <chrono>
+#include <filesystem>
+#include <future>
 #include <memory>
+#include <vector>
 
 namespace trading {
 
@@ -18,14 +24,27 @@ struct ProcessingStats {
     void print(const std::string& filename) const;
 };
 
-struct AggTrade {
-    int64_t id;
-    double price;
-    double qty;
-    double quoteQty;
-    int64_t time;
-    bool isBuyerMaker;
-    int count;
+// 单个周期的累计delta和session内的VWAP累加值
+struct DeltaCarry {
+    int64_t cumulativeDelta{0};  // lots
+    int64_t sessionDelta{0};     // lots
+    int64_t session{0};  // session累计值所属session的起始时间
+    int64_t sessionVolume{0};    // lots
+    double sessionPriceVolume{0.0};  // sum(price * lots)
+    double sessionPriceSqVolume{0.0};
+    // 最后一根已输出的K线，下一个文件从它开始补齐开头的空档
+    int64_t lastTimestamp{0};
+    double lastClose{0.0};
+    int lastScale{0};  // 输出时按 targetLevels 放大后的档位高度
+};
+
+// 按时间顺序从上一个文件延续到下一个文件的状态
+struct SeriesCarry {
+    std::vector<DeltaCarry> deltas;      // 每个周期的累计delta，不含尚未输出的末尾K线
+    std::vector<FootprintBar> tailBars;  // 每个周期尚未输出的末尾K线，timestamp为0表示该周期没有
+
+    std::string toJson() const;
+    static SeriesCarry fromJson(const std::string& content);
 };
 
 class Processor {
@@ -35,18 +54,54 @@ public:
              const ProcessConfig& processConfig,
              const SymbolConfig& symbolConfig);
              
+    // 单独处理一个文件，累计值从零开始
     void processFile(const std::string& filename);
+    // 按文件名排序后并行处理，累计值按顺序在文件之间传递
+    void processFiles(std::vector<std::string> filenames);
+
+    // 多品种批处理：由文件名解析品种并使用注册表中的配置，未注册的品种跳过。所有品种共享
+    // processConfig.threadCount 个工作线程，累计值只在同一品种的文件之间传递
+    static void processBatch(const ProcessConfig& processConfig,
+                             const SymbolRegistry& registry,
+                             const std::string& exchange,
+                             const std::string& format,
+                             std::vector<std::string> filenames);
     
 private:
+    // 同一品种按时间排序的文件及其之间传递的状态
+    struct FileChain;
+    static void runChains(std::vector<FileChain>& chains, int threadCount);
+
     std::unique_ptr<DataFetcher> fetcher_;
     std::unique_ptr<OutputHandler> outputHandler_;
     ProcessConfig processConfig_;
     SymbolConfig symbolConfig_;
+    FootprintGenerator footprintGenerator_;
     
+    void processFile(const std::string& filename,
+                     const std::shared_future<SeriesCarry>& previous,
+                     std::promise<SeriesCarry>& next,
+                     bool hasSuccessor);
     std::vector<Trade> parseFile(const std::string& filename, ProcessingStats& stats);
-    std::vector<FootprintBar> generateFootprint(const std::vector<Trade>& trades);
-    std::vector<AggTrade> generateAggTrades(const std::vector<Trade>& trades);
+    std::filesystem::path outputPath(const std::string& dir, const std::string& filename,
+                                     const std::string& extension) const;
+    std::filesystem::path footprintPath(const std::string& filename, int64_t duration) const;
+    // 最细周期、快照和聚合成交在同一次遍历成交中生成
+    std::vector<std::vector<FootprintBar>> generateFootprint(const std::vector<Trade>& trades,
+                                                             std::vector<BarSnapshot>* snapshots,
+                                                             std::vector<AggTrade>* aggTrades);
+    void stitchTailBars(std::vector<std::vector<FootprintBar>>& footprints,
+                        const std::vector<FootprintBar>& tailBars) const;
+    std::vector<DeltaCarry> applyCarry(std::vector<std::vector<FootprintBar>>& footprints,
+                                       const std::vector<DeltaCarry>& deltas) const;
+    // 按 targetLevels 放大档位高度的倍数，不需要放大时为1
+    int levelScaleFactor(const FootprintBar& bar) const;
+    void adaptLevelScale(std::vector<FootprintBar>& bars) const;
     void writeAggTrades(const std::string& filename, const std::vector<AggTrade>& aggTrades);
+    void writeCvd(const std::string& filename, const std::vector<FootprintBar>& bars);
+    void writeSnapshots(const std::string& filename, const std::vector<BarSnapshot>& snapshots);
+    std::vector<VolumeProfile> generateProfiles(const std::vector<FootprintBar>& bars,
+                                                int64_t duration) const;
 };
 
 } // namespace trading 
\ No newline at end of file
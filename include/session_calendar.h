@@ -0,0 +1,83 @@
+#pragma once
+#include "config.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 标准库带有时区数据库(C++20 tzdb，如MSVC)时使用 std::chrono::locate_zone，
+// 否则读取 /usr/share/zoneinfo 下的TZif文件，只适用于POSIX系统
+#if defined(__cpp_lib_chrono) && __cpp_lib_chrono >= 201907L
+#define TRADING_HAS_CHRONO_TZDB 1
+#else
+#define TRADING_HAS_CHRONO_TZDB 0
+#endif
+
+namespace trading {
+
+// IANA时区。由 std::chrono 时区数据库或TZif文件加载，TZif文件
+// 最后一个转换时刻之后按文件末尾的POSIX TZ规则(Mm.w.d格式)推算
+class TimeZone {
+public:
+    // UTC，无转换
+    TimeZone() = default;
+    static TimeZone load(const std::string& name);
+
+    // 给定UTC时刻的本地时间偏移(秒，东正西负)
+    int64_t offsetAt(int64_t utc) const;
+    // 本地时间换算为UTC；夏令时跳过的本地时间按跳变前的偏移换算，重复的本地时间取较早的一个
+    int64_t toUtc(int64_t local) const;
+
+private:
+    struct Rule {
+        int month{0};
+        int week{0};     // 1-5，5表示最后一周
+        int weekday{0};  // 0为周日
+        int64_t time{7200};  // 本地时间当天的秒数
+    };
+
+#if TRADING_HAS_CHRONO_TZDB
+    const std::chrono::time_zone* zone_{nullptr};
+#endif
+
+    std::vector<int64_t> transitions_;
+    std::vector<int64_t> offsets_;  // offsets_[i] 为 transitions_[i] 之后的偏移
+    int64_t initialOffset_{0};
+
+    // POSIX TZ规则，hasRule_ 为false时之后一直使用 stdOffset_
+    bool hasRule_{false};
+    int64_t stdOffset_{0};
+    int64_t dstOffset_{0};
+    Rule dstStart_;
+    Rule dstEnd_;
+
+    void parsePosixRule(const std::string& rule);
+    int64_t ruleOffsetAt(int64_t utc) const;
+};
+
+// 按时区和session对齐的时间K线边界。
+// session从本地时间每天 sessionOffset 秒开始，session内按 duration 切分，
+// 每个session重新对齐，夏令时切换日的最后一根K线相应变短或变长；
+// duration 为整天的倍数时每 duration/86400 个session一根K线。
+// 边界按天成批预先生成，构建K线时只需与下一个边界比较
+class SessionCalendar {
+public:
+    SessionCalendar(const SymbolConfig& config, int64_t duration);
+
+    // 返回包含 time 的K线的起始时刻，之后 end() 为该K线的结束时刻
+    int64_t open(int64_t time);
+    int64_t end() const { return boundaries_[cursor_ + 1]; }
+
+private:
+    TimeZone zone_;
+    int64_t sessionOffset_;
+    int64_t duration_;
+    std::vector<int64_t> boundaries_;
+    size_t cursor_{0};
+    int64_t nextDay_{0};  // 下一个待生成的本地日期(自1970-01-01的天数)
+
+    int64_t sessionStart(int64_t day) const;
+    void generateDay();
+};
+
+} // namespace trading
@@ -0,0 +1,40 @@
+#pragma once
+#include "config.h"
+#include <map>
+#include <string>
+
+namespace trading {
+
+// 品种到 SymbolConfig 的映射。未注册的品种没有配置，按默认精度处理会把
+// 价格数量级不同的品种全部分到错误的档位，调用方应跳过
+class SymbolRegistry {
+public:
+    // defaultConfig 为注册时未给出的字段提供默认值
+    explicit SymbolRegistry(const SymbolConfig& defaultConfig = {})
+        : defaultConfig_(defaultConfig) {}
+
+    // 内置常用品种，精度与档位高度和 footprint_builder.cpp 中的编译期特化表一致
+    static SymbolRegistry withDefaults();
+
+    // 从JSON配置文件加载，格式：
+    //   {"defaults": {"duration": 60, "durations": [300, 900]},
+    //    "symbols": {"BTCUSDT": {"pricePrecision": 1, "volumePrecision": 2,
+    //                            "scale": 100, "lotPrecision": 8}, ...}}
+    // 每个品种未给出的字段取 defaults，再缺省取 SymbolConfig 默认值
+    static SymbolRegistry fromFile(const std::string& filename);
+
+    void add(const std::string& symbol, const SymbolConfig& config);
+    bool contains(const std::string& symbol) const;
+    // 未注册的品种抛出异常
+    const SymbolConfig& get(const std::string& symbol) const;
+    const SymbolConfig& defaultConfig() const { return defaultConfig_; }
+
+    // 由 ETHUSDT-trades-2024-01.csv 这样的文件名解析出品种，取第一个'-'之前的部分
+    static std::string symbolFromFilename(const std::string& filename);
+
+private:
+    SymbolConfig defaultConfig_;
+    std::map<std::string, SymbolConfig> configs_;
+};
+
+} // namespace trading
@@ -12,6 +12,7 @@ struct Trade {
     bool isBuyerMaker;
     bool isBuy;
     double size;
+    int64_t lots;  // size in lots, see toLots()
 
     bool operator<(const Trade& other) const {
         if (time == other.time) return id < other.id;
@@ -0,0 +1,56 @@
+#pragma once
+#include "footprint.h"
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace trading {
+
+// 按session汇总的成交量分布，档位按价格档位序号有序存放，可线性合并
+class VolumeProfile {
+public:
+    struct Level {
+        int64_t level{0};  // price level index
+        int64_t volume{0};   // lots
+        int64_t bidSize{0};  // lots
+        int64_t askSize{0};  // lots
+        int64_t tradesCount{0};
+    };
+
+    VolumeProfile(int64_t sessionStart = 0, int64_t duration = 0, int scale = 0,
+                  int volumePrecision = 0, int pricePrecision = 0,
+                  int lotPrecision = kDefaultLotPrecision);
+
+    // 并入一根K线的有成交档位
+    void addBar(const FootprintBar& bar);
+    // 并入另一个相同档位高度的profile，session范围取并集
+    void merge(const VolumeProfile& other);
+
+    void write(std::ostream& out) const;
+    // 读取一条记录，流结束时返回false
+    bool read(std::istream& in);
+    std::string toJson() const;
+
+    int64_t sessionStart{0};
+    int64_t duration{0};
+    int scale{0};
+    int volumePrecision{0};
+    int pricePrecision{0};
+    int lotPrecision{kDefaultLotPrecision};
+    std::vector<Level> levels;
+
+private:
+    template <typename Source>
+    void mergeLevels(const Source& other);
+};
+
+// 二进制profile文件，每条记录为定长头部加档位数组
+void writeProfiles(const std::string& filename, const std::vector<VolumeProfile>& profiles);
+std::vector<VolumeProfile> readProfiles(const std::string& filename);
+
+// 合并 [from, to) 内开始的所有session，得到复合profile
+VolumeProfile compositeProfile(const std::vector<VolumeProfile>& profiles,
+                               int64_t from, int64_t to);
+
+} // namespace trading
@@ -1,142 +1,482 @@
 #include "footprint.h"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <limits>
 #include "json.hpp"
 
 namespace trading {
 
 using json = nlohmann::json;
 
-std::string FootprintBar::PriceLevel::toJson() const {
+json FootprintBar::PriceLevel::toJsonObject(const RuntimePrecision& precision) const {
     json j;
-    j["price"] = std::round(price * std::pow(10, pricePrecision)) / std::pow(10, pricePrecision);
-    j["volume"] = std::round(volume * std::pow(10, volumePrecision)) / std::pow(10, volumePrecision);
-    j["bidSize"] = std::round(bidSize * std::pow(10, pricePrecision)) / std::pow(10, pricePrecision);
-    j["askSize"] = std::round(askSize * std::pow(10, pricePrecision)) / std::pow(10, pricePrecision);
+    j["price"] = precision.roundPrice(price);
+    j["volume"] = precision.roundLots(volume);
+    j["bidSize"] = precision.roundLots(bidSize);
+    j["askSize"] = precision.roundLots(askSize);
     j["bidCount"] = bidCount;
     j["askCount"] = askCount;
-    j["delta"] = std::round(delta * std::pow(10, volumePrecision)) / std::pow(10, volumePrecision);
+    j["delta"] = precision.roundLots(delta);
     j["tradesCount"] = tradesCount;
-    return j.dump();
+    j["buyImbalance"] = buyImbalance;
+    j["sellImbalance"] = sellImbalance;
+    j["largeBidCount"] = largeBidCount;
+    j["largeAskCount"] = largeAskCount;
+    j["largeBidSize"] = precision.roundLots(largeBidSize);
+    j["largeAskSize"] = precision.roundLots(largeAskSize);
+    return j;
+}
+
+void FootprintBar::PriceLevel::add(const PriceLevel& other) {
+    volume += other.volume;
+    bidSize += other.bidSize;
+    askSize += other.askSize;
+    bidCount += other.bidCount;
+    askCount += other.askCount;
+    delta += other.delta;
+    tradesCount += other.tradesCount;
+    largeBidCount += other.largeBidCount;
+    largeAskCount += other.largeAskCount;
+    largeBidSize += other.largeBidSize;
+    largeAskSize += other.largeAskSize;
 }
 
-FootprintBar::FootprintBar(int duration, int scale, int volumePrecision, int pricePrecision)
+FootprintBar::FootprintBar(int duration, int scale, int volumePrecision, int pricePrecision,
+                           int lotPrecision)
     : duration(duration)
     , scale(scale)
     , volumePrecision(volumePrecision)
-    , pricePrecision(pricePrecision) {}
+    , pricePrecision(pricePrecision)
+    , lotPrecision(lotPrecision) {}
 
-double FootprintBar::getPriceLevelHeight() {
-    if (priceLevelHeight == 0) {
-        priceLevelHeight = scale * std::pow(10, -pricePrecision);
+void FootprintBar::computeValueArea(double valueAreaPercent) {
+    if (priceLevels.empty()) {
+        return;
+    }
+
+    size_t pocIndex = 0;
+    for (size_t i = 1; i < priceLevels.size(); ++i) {
+        if (priceLevels[i].volume > priceLevels[pocIndex].volume) {
+            pocIndex = i;
+        }
+    }
+
+    // 从POC向两侧扩展，每次并入成交量较大的一侧，直到覆盖目标成交量
+    double target = static_cast<double>(volume) * valueAreaPercent;
+    int64_t covered = priceLevels[pocIndex].volume;
+    size_t low = pocIndex;
+    size_t high = pocIndex;
+    while (static_cast<double>(covered) < target && (low > 0 || high + 1 < priceLevels.size())) {
+        int64_t below = low > 0 ? priceLevels[low - 1].volume : -1;
+        int64_t above = high + 1 < priceLevels.size() ? priceLevels[high + 1].volume : -1;
+        if (above >= below) {
+            covered += priceLevels[++high].volume;
+        } else {
+            covered += priceLevels[--low].volume;
+        }
     }
-    return priceLevelHeight;
-}
 
-double FootprintBar::normalizePrice(double price) {
-    double height = getPriceLevelHeight();
-    return std::round(std::floor(price / height) * height * std::pow(10, pricePrecision)) /
-           std::pow(10, pricePrecision);
+    poc = priceLevels[pocIndex].price;
+    vah = priceLevels[high].price;
+    val = priceLevels[low].price;
 }
 
-bool FootprintBar::handleTick(const Trade& tick) {
-    if (timestamp == 0) {
-        timestamp = tick.time / duration * duration;
-        openTime = tick.time;
-        closeTime = tick.time;
-        open = normalizePrice(tick.price);
-        close = normalizePrice(tick.price);
-        high = normalizePrice(tick.price);
-        low = normalizePrice(tick.price);
+void FootprintBar::computeImbalances(double ratio, int minStacked) {
+    size_t n = priceLevels.size();
+    if (n == 0) {
+        return;
+    }
+
+    // 先按列展开本档位和对角档位的成交量。相邻档位没有成交时对角比较无意义，
+    // 对角成交量记为无穷大，否则每根K线最低和最高的档位几乎总被标为失衡
+    constexpr double kMissing = std::numeric_limits<double>::infinity();
+    std::vector<double> ask(n), bid(n), bidBelow(n), askAbove(n);
+    for (size_t i = 0; i < n; ++i) {
+        const auto& level = priceLevels[i];
+        ask[i] = static_cast<double>(level.askSize);
+        bid[i] = static_cast<double>(level.bidSize);
+        bool hasBelow = i > 0 && priceLevels[i - 1].level + 1 == level.level;
+        bool hasAbove = i + 1 < n && priceLevels[i + 1].level == level.level + 1;
+        bidBelow[i] = hasBelow ? static_cast<double>(priceLevels[i - 1].bidSize) : kMissing;
+        askAbove[i] = hasAbove ? static_cast<double>(priceLevels[i + 1].askSize) : kMissing;
     }
 
-    if (tick.time < timestamp || tick.time >= timestamp + duration) {
-        return false;
+    // 连续数组上的比较循环没有分支，可以向量化。标志以0/1的double保存，
+    // 比较结果与操作数同宽，SSE2下不需要收窄或转换为整数
+    std::vector<double> buyFlags(n), sellFlags(n);
+    const double* askData = ask.data();
+    const double* bidData = bid.data();
+    const double* bidBelowData = bidBelow.data();
+    const double* askAboveData = askAbove.data();
+    double* buy = buyFlags.data();
+    double* sell = sellFlags.data();
+    for (size_t i = 0; i < n; ++i) {
+        buy[i] = (askData[i] > 0.0) & (askData[i] >= ratio * bidBelowData[i]) ? 1.0 : 0.0;
+        sell[i] = (bidData[i] > 0.0) & (bidData[i] >= ratio * askAboveData[i]) ? 1.0 : 0.0;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        priceLevels[i].buyImbalance = buy[i] != 0.0;
+        priceLevels[i].sellImbalance = sell[i] != 0.0;
     }
 
-    double tickScalePrice = normalizePrice(tick.price);
+    stackedImbalances.clear();
+    auto collectStacks = [&](bool buy, bool PriceLevel::*flag) {
+        size_t runStart = 0;
+        size_t runLength = 0;
+        auto flush = [&]() {
+            if (static_cast<int>(runLength) >= minStacked) {
+                stackedImbalances.push_back({buy, priceLevels[runStart].price,
+                                             priceLevels[runStart + runLength - 1].price,
+                                             static_cast<int>(runLength)});
+            }
+            runLength = 0;
+        };
+        for (size_t i = 0; i < n; ++i) {
+            if (!(priceLevels[i].*flag)) {
+                flush();
+            } else if (runLength > 0 && priceLevels[i - 1].level + 1 == priceLevels[i].level) {
+                ++runLength;
+            } else {
+                flush();
+                runStart = i;
+                runLength = 1;
+            }
+        }
+        flush();
+    };
+    collectStacks(true, &PriceLevel::buyImbalance);
+    collectStacks(false, &PriceLevel::sellImbalance);
+}
 
-    if (priceLevels.find(tickScalePrice) == priceLevels.end()) {
-        priceLevels[tickScalePrice] = PriceLevel(volumePrecision, pricePrecision);
-        priceLevels[tickScalePrice].price = tickScalePrice;
+void FootprintBar::computeAverages() {
+    if (volume > 0) {
+        double lots = static_cast<double>(volume);
+        vwap = priceVolume / lots;
+        stddev = std::sqrt(std::max(priceSqVolume / lots - vwap * vwap, 0.0));
+    } else {
+        vwap = close;
+        stddev = 0.0;
     }
+    twap = (timePrice + close) / static_cast<double>(closeTime - openTime + 1);
+}
 
-    auto& priceLevel = priceLevels[tickScalePrice];
+void FootprintBar::coarsen(int factor) {
+    if (factor <= 1) {
+        return;
+    }
+    scale *= factor;
+    RuntimePrecision precision = runtimePrecision();
 
-    if (tick.time > closeTime) {
-        closeTime = tick.time;
-        close = tick.price;
+    // 档位有序，归档后的档位序号单调不减，原地合并
+    size_t count = 0;
+    for (const auto& level : priceLevels) {
+        int64_t coarse = level.level / factor;
+        if (count > 0 && priceLevels[count - 1].level == coarse) {
+            priceLevels[count - 1].add(level);
+            continue;
+        }
+        auto& target = priceLevels[count++];
+        target = level;
+        target.level = coarse;
+        target.price = precision.levelToPrice(coarse);
+        target.buyImbalance = false;
+        target.sellImbalance = false;
     }
+    priceLevels.resize(count);
+}
 
-    if (tick.time < openTime) {
-        openTime = tick.time;
-        open = tick.price;
+void FootprintBar::mergeTotals(const FootprintBar& later) {
+    // 本段只有开盘一秒时，合并后开盘价延续的秒数由后一段决定
+    if (closeTime == openTime) {
+        openSpan = later.openTime > closeTime ? later.openTime - closeTime : later.openSpan;
+    }
+    // 两段之间没有成交的秒沿用前一段的收盘价
+    if (later.openTime > closeTime) {
+        timePrice += close * static_cast<double>(later.openTime - closeTime);
+    } else if (later.openTime == closeTime) {
+        // 同一秒的成交分在两段：该秒的价格是前一段在该秒的第一笔，
+        // 后一段按自己的开盘价计入了 openSpan 秒，换成前一段的价格
+        timePrice += (close - later.open) * static_cast<double>(later.openSpan);
     }
+    timePrice += later.timePrice;
+    priceVolume += later.priceVolume;
+    priceSqVolume += later.priceSqVolume;
+    sizeSqLots += later.sizeSqLots;
 
-    high = std::max(high, tick.price);
-    low = std::min(low, tick.price);
+    // 两段各自的大单阈值可能不同，取较小者
+    if (later.largeThreshold > 0 &&
+        (largeThreshold == 0 || later.largeThreshold < largeThreshold)) {
+        largeThreshold = later.largeThreshold;
+    }
 
-    if (tick.isBuy) {
-        priceLevel.askSize += tick.size;
-        priceLevel.askCount++;
-        priceLevel.delta += tick.size;
-    } else {
-        priceLevel.bidSize += tick.size;
-        priceLevel.bidCount++;
-        priceLevel.delta -= tick.size;
+    if (later.closeTime > closeTime) {
+        closeTime = later.closeTime;
+        close = later.close;
+    }
+    if (later.openTime < openTime) {
+        openTime = later.openTime;
+        open = later.open;
     }
+    high = std::max(high, later.high);
+    low = std::min(low, later.low);
+    volume += later.volume;
+    delta += later.delta;
+    tradesCount += later.tradesCount;
+}
 
-    priceLevel.volume += tick.size;
-    priceLevel.tradesCount++;
+void FootprintBar::merge(const FootprintBar& later) {
+    mergeTotals(later);
+    topTrades.insert(topTrades.end(), later.topTrades.begin(), later.topTrades.end());
+    std::stable_sort(topTrades.begin(), topTrades.end(), &LargeTrade::larger);
 
-    volume += tick.size;
-    tradesCount++;
-    delta += tick.isBuy ? tick.size : -tick.size;
-    return true;
+    // 有序档位线性归并，档位数组只包含有成交的档位
+    std::vector<PriceLevel> merged;
+    merged.reserve(priceLevels.size() + later.priceLevels.size());
+    auto append = [&](const PriceLevel& level) {
+        if (!merged.empty() && merged.back().level == level.level) {
+            merged.back().add(level);
+            return;
+        }
+        merged.push_back(level);
+    };
+    size_t i = 0;
+    size_t j = 0;
+    while (i < priceLevels.size() || j < later.priceLevels.size()) {
+        if (j == later.priceLevels.size() ||
+            (i < priceLevels.size() && priceLevels[i].level <= later.priceLevels[j].level)) {
+            append(priceLevels[i++]);
+        } else {
+            append(later.priceLevels[j++]);
+        }
+    }
+    priceLevels.swap(merged);
 }
 
-void FootprintBar::fillNoTradesPriceLevels() {
-    double priceInterval = std::pow(10, -pricePrecision) * scale;
-    double price = normalizePrice(open);
-    double priceEnd = normalizePrice(close);
+nlohmann::json FootprintBar::toState() const {
+    json levels = json::array();
+    for (const auto& level : priceLevels) {
+        levels.push_back({level.level, level.volume, level.bidSize, level.askSize,
+                          level.bidCount, level.askCount, level.delta, level.tradesCount,
+                          level.largeBidCount, level.largeAskCount,
+                          level.largeBidSize, level.largeAskSize});
+    }
+    json trades = json::array();
+    for (const auto& trade : topTrades) {
+        trades.push_back({trade.time, trade.price, trade.size, trade.isBuy});
+    }
+    return {
+        {"timestamp", timestamp},
+        {"duration", duration},
+        {"scale", scale},
+        {"volumePrecision", volumePrecision},
+        {"pricePrecision", pricePrecision},
+        {"lotPrecision", lotPrecision},
+        {"openTime", openTime},
+        {"closeTime", closeTime},
+        {"open", open},
+        {"high", high},
+        {"low", low},
+        {"close", close},
+        {"volume", volume},
+        {"delta", delta},
+        {"tradesCount", tradesCount},
+        {"priceVolume", priceVolume},
+        {"priceSqVolume", priceSqVolume},
+        {"sizeSqLots", sizeSqLots},
+        {"timePrice", timePrice},
+        {"openSpan", openSpan},
+        {"largeThreshold", largeThreshold},
+        {"topTrades", trades},
+        {"priceLevels", levels},
+    };
+}
 
-    while (price <= priceEnd) {
-        if (priceLevels.find(price) == priceLevels.end()) {
-            priceLevels[price] = PriceLevel(volumePrecision, pricePrecision);
-            priceLevels[price].price = price;
+FootprintBar FootprintBar::fromState(const nlohmann::json& state) {
+    FootprintBar bar(state.at("duration").get<int>(), state.at("scale").get<int>(),
+                     state.at("volumePrecision").get<int>(),
+                     state.at("pricePrecision").get<int>(),
+                     state.value("lotPrecision", kDefaultLotPrecision));
+    RuntimePrecision precision = bar.runtimePrecision();
+    bar.timestamp = state.at("timestamp").get<int64_t>();
+    bar.openTime = state.at("openTime").get<int64_t>();
+    bar.closeTime = state.at("closeTime").get<int64_t>();
+    bar.open = state.at("open").get<double>();
+    bar.high = state.at("high").get<double>();
+    bar.low = state.at("low").get<double>();
+    bar.close = state.at("close").get<double>();
+    bar.volume = state.at("volume").get<int64_t>();
+    bar.delta = state.at("delta").get<int64_t>();
+    bar.tradesCount = state.at("tradesCount").get<int>();
+    bar.priceVolume = state.value("priceVolume", 0.0);
+    bar.priceSqVolume = state.value("priceSqVolume", 0.0);
+    bar.sizeSqLots = state.value("sizeSqLots", 0.0);
+    bar.timePrice = state.value("timePrice", 0.0);
+    bar.openSpan = state.value("openSpan", int64_t{0});
+    bar.largeThreshold = state.value("largeThreshold", int64_t{0});
+    if (state.contains("topTrades")) {
+        for (const auto& item : state.at("topTrades")) {
+            bar.topTrades.push_back({item.at(0).get<int64_t>(), item.at(1).get<double>(),
+                                     item.at(2).get<int64_t>(), item.at(3).get<bool>()});
+        }
+    }
+    for (const auto& item : state.at("priceLevels")) {
+        PriceLevel level;
+        level.level = item.at(0).get<int64_t>();
+        level.price = precision.levelToPrice(level.level);
+        level.volume = item.at(1).get<int64_t>();
+        level.bidSize = item.at(2).get<int64_t>();
+        level.askSize = item.at(3).get<int64_t>();
+        level.bidCount = item.at(4).get<int>();
+        level.askCount = item.at(5).get<int>();
+        level.delta = item.at(6).get<int64_t>();
+        level.tradesCount = item.at(7).get<int>();
+        if (item.size() > 8) {
+            level.largeBidCount = item.at(8).get<int>();
+            level.largeAskCount = item.at(9).get<int>();
+            level.largeBidSize = item.at(10).get<int64_t>();
+            level.largeAskSize = item.at(11).get<int64_t>();
         }
-        price += priceInterval;
+        bar.priceLevels.push_back(level);
+    }
+    return bar;
+}
+
+FootprintBar FootprintBar::placeholder(const FootprintBar& previous, int64_t timestamp,
+                                       bool sameSession) {
+    FootprintBar bar(previous.duration, previous.scale, previous.volumePrecision,
+                     previous.pricePrecision, previous.lotPrecision);
+    double close = previous.close;
+    bar.timestamp = timestamp;
+    bar.openTime = timestamp;
+    bar.closeTime = timestamp;
+    bar.open = bar.high = bar.low = bar.close = close;
+    bar.poc = bar.vah = bar.val = close;
+    bar.vwap = bar.twap = close;
+    bar.cumulativeDelta = previous.cumulativeDelta;
+    if (sameSession) {
+        bar.sessionDelta = previous.sessionDelta;
+        bar.sessionVwap = previous.sessionVwap;
+        bar.sessionStddev = previous.sessionStddev;
+    } else {
+        bar.sessionVwap = close;
     }
+    return bar;
 }
 
-void FootprintBar::endHandleTick() {
-    fillNoTradesPriceLevels();
+std::string FootprintBar::toJson(bool fillEmptyLevels) const {
+    return toJsonObject(fillEmptyLevels).dump(4);
 }
 
-std::string FootprintBar::toJson() const {
+json FootprintBar::toJsonObject(bool fillEmptyLevels) const {
+    RuntimePrecision precision = runtimePrecision();
+
     json j;
     j["timestamp"] = timestamp;
     j["duration"] = duration;
     j["scale"] = scale;
     j["openTime"] = openTime;
     j["closeTime"] = closeTime;
-    j["open"] = std::round(open * std::pow(10, pricePrecision)) / std::pow(10, pricePrecision);
-    j["high"] = std::round(high * std::pow(10, pricePrecision)) / std::pow(10, pricePrecision);
-    j["low"] = std::round(low * std::pow(10, pricePrecision)) / std::pow(10, pricePrecision);
-    j["close"] = std::round(close * std::pow(10, pricePrecision)) / std::pow(10, pricePrecision);
-    j["volume"] = std::round(volume * std::pow(10, volumePrecision)) / std::pow(10, volumePrecision);
-    j["delta"] = std::round(delta * std::pow(10, volumePrecision)) / std::pow(10, volumePrecision);
+    j["open"] = precision.roundPrice(open);
+    j["high"] = precision.roundPrice(high);
+    j["low"] = precision.roundPrice(low);
+    j["close"] = precision.roundPrice(close);
+    j["volume"] = precision.roundLots(volume);
+    j["delta"] = precision.roundLots(delta);
+    j["cvd"] = precision.roundLots(cumulativeDelta);
+    j["sessionCvd"] = precision.roundLots(sessionDelta);
     j["tradesCount"] = tradesCount;
     j["volumePrecision"] = volumePrecision;
     j["pricePrecision"] = pricePrecision;
+    j["poc"] = precision.roundPrice(poc);
+    j["vah"] = precision.roundPrice(vah);
+    j["val"] = precision.roundPrice(val);
+    j["vwap"] = precision.roundPrice(vwap);
+    j["twap"] = precision.roundPrice(twap);
+    j["stddev"] = precision.roundPrice(stddev);
+    j["sessionVwap"] = precision.roundPrice(sessionVwap);
+    j["sessionStddev"] = precision.roundPrice(sessionStddev);
 
-    json priceLevelsJson;
-    for (const auto& [price, level] : priceLevels) {
-        std::string priceStr = std::to_string(std::round(price * std::pow(10, pricePrecision)) / std::pow(10, pricePrecision));
-        priceLevelsJson[priceStr] = json::parse(level.toJson());
+    json priceLevelsJson = json::object();
+    auto appendLevel = [&](const PriceLevel& level) {
+        std::string priceStr = std::to_string(level.price);
+        priceLevelsJson[priceStr] = level.toJsonObject(precision);
+    };
+    // 开盘到收盘之间没有成交的档位不存储，按需在输出时补齐
+    int64_t openLevel = precision.priceToLevel(open);
+    int64_t closeLevel = precision.priceToLevel(close);
+    int64_t next = openLevel;
+    for (const auto& level : priceLevels) {
+        if (fillEmptyLevels) {
+            for (; next < level.level && next <= closeLevel; ++next) {
+                PriceLevel empty;
+                empty.level = next;
+                empty.price = precision.levelToPrice(next);
+                appendLevel(empty);
+            }
+            next = std::max(next, level.level + 1);
+        }
+        appendLevel(level);
+    }
+    for (; fillEmptyLevels && next <= closeLevel; ++next) {
+        PriceLevel empty;
+        empty.level = next;
+        empty.price = precision.levelToPrice(next);
+        appendLevel(empty);
     }
     j["priceLevels"] = priceLevelsJson;
 
-    return j.dump(4);
+    json stackedJson = json::array();
+    for (const auto& stack : stackedImbalances) {
+        stackedJson.push_back({
+            {"side", stack.buy ? "buy" : "sell"},
+            {"low", precision.roundPrice(stack.low)},
+            {"high", precision.roundPrice(stack.high)},
+            {"levels", stack.levels},
+        });
+    }
+    j["stackedImbalances"] = stackedJson;
+
+    j["largeThreshold"] = precision.roundLots(largeThreshold);
+    json topTradesJson = json::array();
+    for (const auto& trade : topTrades) {
+        topTradesJson.push_back({
+            {"time", trade.time},
+            {"price", precision.roundPrice(trade.price)},
+            {"size", precision.roundLots(trade.size)},
+            {"side", trade.isBuy ? "buy" : "sell"},
+        });
+    }
+    j["topTrades"] = topTradesJson;
+
+    return j;
+}
+
+std::string BarSnapshot::toJson(const RuntimePrecision& precision) const {
+    json levelsJson = json::array();
+    for (const auto& level : levels) {
+        levelsJson.push_back({
+            precision.roundPrice(level.price),
+            precision.roundLots(level.bidSize),
+            precision.roundLots(level.askSize),
+            level.bidCount,
+            level.askCount,
+        });
+    }
+    json j = {
+        {"bar", barTimestamp},
+        {"time", time},
+        {"seq", seq},
+        {"open", precision.roundPrice(open)},
+        {"high", precision.roundPrice(high)},
+        {"low", precision.roundPrice(low)},
+        {"close", precision.roundPrice(close)},
+        {"volume", precision.roundLots(volume)},
+        {"delta", precision.roundLots(delta)},
+        {"tradesCount", tradesCount},
+        {"levels", levelsJson},  // [price, bidSize, askSize, bidCount, askCount]
+    };
+    return j.dump();
 }
 
-} // namespace trading 
\ No newline at end of file
+} // namespace trading
@@ -0,0 +1,71 @@
+#include "footprint_builder.h"
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace trading {
+
+namespace {
+
+struct PrecisionDispatch {
+    int pricePrecision;
+    int volumePrecision;
+    int scale;
+    FootprintGenerator (*select)(BarType);
+};
+
+constexpr PrecisionDispatch kPrecisionDispatch[] = {
+    {1, 2, 100, &selectBarPolicy<StaticPrecision<1, 2, 100>>},  // BTCUSDT
+    {1, 2, 10,  &selectBarPolicy<StaticPrecision<1, 2, 10>>},   // BTCUSDT, fine levels
+    {2, 3, 10,  &selectBarPolicy<StaticPrecision<2, 3, 10>>},   // ETHUSDT
+    {2, 2, 1,   &selectBarPolicy<StaticPrecision<2, 2, 1>>},    // SOLUSDT
+};
+
+// 非时间K线必须有正的 barSize，否则策略拒绝所有成交只产生空K线，
+// 区间K线每次价格变化都收线，Renko砖块高度为0时除零
+void validateBarSize(const SymbolConfig& config) {
+    auto require = [&](bool valid, const char* barName, const char* expected) {
+        if (!valid) {
+            throw std::runtime_error(std::string(barName) + " bars need barSize to be " +
+                                     expected + ", got " + std::to_string(config.barSize));
+        }
+    };
+    switch (config.barType) {
+        case BarType::Volume:
+            require(RuntimePrecision(config).toLots(config.barSize) > 0, "Volume", "positive");
+            break;
+        case BarType::Tick:
+            require(config.barSize >= 1 && config.barSize == std::floor(config.barSize),
+                    "Tick", "a positive whole trade count");
+            break;
+        case BarType::Dollar:
+            require(config.barSize > 0, "Dollar", "positive");
+            break;
+        case BarType::Range:
+            require(config.barSize >= 1 && config.barSize == std::floor(config.barSize),
+                    "Range", "a positive whole number of ticks");
+            break;
+        case BarType::Renko:
+            require(config.barSize >= 1 && config.barSize == std::floor(config.barSize),
+                    "Renko", "a positive whole number of ticks");
+            break;
+        default:
+            break;
+    }
+}
+
+} // namespace
+
+FootprintGenerator selectFootprintGenerator(const SymbolConfig& config) {
+    validateBarSize(config);
+    for (const auto& entry : kPrecisionDispatch) {
+        if (entry.pricePrecision == config.pricePrecision &&
+            entry.volumePrecision == config.volumePrecision &&
+            entry.scale == config.scale) {
+            return entry.select(config.barType);
+        }
+    }
+    return selectBarPolicy<RuntimePrecision>(config.barType);
+}
+
+} // namespace trading
@@ -0,0 +1,64 @@
+#include "heatmap_tensor.h"
+#include "precision.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+
+namespace trading {
+
+namespace {
+
+template <typename T>
+void writeValue(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+} // namespace
+
+void writeHeatmapTensor(std::ostream& out, const std::vector<FootprintBar>& bars, int levels) {
+    if (levels <= 0) {
+        throw std::runtime_error("Heatmap tensor needs a positive level count");
+    }
+    out.write("FPHM", 4);
+    writeValue(out, static_cast<uint64_t>(bars.size()));
+    writeValue(out, static_cast<uint32_t>(levels));
+    writeValue(out, static_cast<uint32_t>(kHeatmapChannels));
+    for (const auto& bar : bars) {
+        writeValue(out, bar.timestamp);
+    }
+
+    // 逐根K线复用同一行缓冲区，直接由档位数组填充
+    std::vector<float> rows(static_cast<size_t>(levels) * kHeatmapChannels);
+    for (const auto& bar : bars) {
+        std::fill(rows.begin(), rows.end(), 0.0f);
+        RuntimePrecision precision = bar.runtimePrecision();
+        int64_t first = precision.priceToLevel(bar.close) - levels / 2;
+        int64_t last = first + levels;
+
+        auto it = std::lower_bound(bar.priceLevels.begin(), bar.priceLevels.end(), first,
+                                   [](const FootprintBar::PriceLevel& level, int64_t index) {
+                                       return level.level < index;
+                                   });
+        for (; it != bar.priceLevels.end() && it->level < last; ++it) {
+            float* row = &rows[static_cast<size_t>(it->level - first) * kHeatmapChannels];
+            row[0] = static_cast<float>(precision.fromLots(it->bidSize));
+            row[1] = static_cast<float>(precision.fromLots(it->askSize));
+            row[2] = static_cast<float>(precision.fromLots(it->delta));
+            row[3] = static_cast<float>(it->tradesCount);
+        }
+        out.write(reinterpret_cast<const char*>(rows.data()),
+                  static_cast<std::streamsize>(rows.size() * sizeof(float)));
+    }
+}
+
+void writeHeatmapTensor(const std::string& filename, const std::vector<FootprintBar>& bars,
+                        int levels) {
+    std::ofstream outfile(filename, std::ios::binary);
+    if (!outfile) {
+        throw std::runtime_error("Failed to open output file: " + filename);
+    }
+    writeHeatmapTensor(outfile, bars, levels);
+}
+
+} // namespace trading
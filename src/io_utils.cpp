@@ -61,6 +61,11 @@ char* FastFormatter::formatInt(char* buf, int64_t val) {
 }
 
 char* FastFormatter::formatDouble(char* buf, double val, int precision) {
+    // 负数单独输出符号，否则(-1, 0)区间的值会丢失符号
+    if (val < 0) {
+        *buf++ = '-';
+        val = -val;
+    }
     int64_t int_part = static_cast<int64_t>(val);
     char* p = formatInt(buf, int_part);
     *p++ = '.';
@@ -1,47 +1,30 @@
 #include "processor.h"
-#include <thread>
-#include <semaphore>
 #include <filesystem>
+#include <string>
+#include <vector>
 
 namespace fs = std::filesystem;
 
-constexpr int max_thread_count = 64;
-
-int main() {
+// 用法: trading_processor [symbols.json]
+int main(int argc, char** argv) {
     trading::ProcessConfig processConfig;
     processConfig.inputDir = "/mnt/d/orderdata/binance/unsorted_rawdata";
     processConfig.outputDir = "/mnt/d/orderdata/binance/";
     
-    trading::SymbolConfig symbolConfig;
-    
-    auto fetcher = trading::DataFetcher::create("binance");
-    auto outputHandler = trading::OutputHandler::create("json");
-    
-    trading::Processor processor(
-        std::move(fetcher),
-        std::move(outputHandler),
-        processConfig,
-        symbolConfig
-    );
-    
-    processConfig.threadCount = std::min(max_thread_count, processConfig.threadCount);
+    // 各品种的精度、档位高度和周期，可由配置文件给出；未注册品种的文件被跳过
+    auto registry = argc > 1 ? trading::SymbolRegistry::fromFile(argv[1])
+                             : trading::SymbolRegistry::withDefaults();
 
-    std::vector<std::thread> threads;
-    std::counting_semaphore<max_thread_count> sem(processConfig.threadCount);
-    
+    std::vector<std::string> files;
     for (const auto& entry : fs::directory_iterator(processConfig.inputDir)) {
         if (entry.path().extension() != ".csv") continue;
-        
-        threads.emplace_back([&sem, &processor, entry]() {
-            sem.acquire();
-            processor.processFile(entry.path().string());
-            sem.release();
-        });
-    }
-    
-    for (auto& t : threads) {
-        t.join();
+        files.push_back(entry.path().string());
     }
+
+    // 按品种分组，各品种的文件按名称排序后共享线程并行处理，
+    // 累计delta在同一品种的相邻文件之间传递
+    trading::Processor::processBatch(processConfig, registry, "binance", "json",
+                                     std::move(files));
     
     return 0;
-} 
\ No newline at end of file
+}
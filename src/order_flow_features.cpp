@@ -0,0 +1,188 @@
+#include "order_flow_features.h"
+#include "precision.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+
+namespace trading {
+
+namespace {
+
+// 累加分道数，数组长度补齐到其整数倍，补齐部分各列均为0
+constexpr size_t kLanes = 4;
+constexpr double kTopThird = 2.0 / 3.0;
+constexpr double kBottomThird = 1.0 / 3.0;
+
+// 分道累加：每道独立的累加链互不依赖，编译器可把同一轮的各道合并为一条向量指令
+template <typename Term>
+double sumLanes(size_t n, Term term) {
+    double lanes[kLanes] = {};
+    for (size_t i = 0; i < n; i += kLanes) {
+        for (size_t l = 0; l < kLanes; ++l) {
+            lanes[l] += term(i + l);
+        }
+    }
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+template <typename Term>
+double maxLanes(size_t n, Term term) {
+    double lanes[kLanes] = {};
+    for (size_t i = 0; i < n; i += kLanes) {
+        for (size_t l = 0; l < kLanes; ++l) {
+            lanes[l] = std::max(lanes[l], term(i + l));
+        }
+    }
+    return std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+}
+
+double ratio(double numerator, double denominator) {
+    return denominator != 0.0 ? numerator / denominator : 0.0;
+}
+
+template <typename T>
+void writeValue(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+void writeColumn(std::ostream& out, const std::vector<T>& column) {
+    out.write(reinterpret_cast<const char*>(column.data()),
+              static_cast<std::streamsize>(column.size() * sizeof(T)));
+}
+
+} // namespace
+
+const std::array<const char*, kFeatureCount>& orderFlowFeatureNames() {
+    static const std::array<const char*, kFeatureCount> names{
+        "volume",
+        "delta",
+        "deltaRatio",
+        "buyImbalanceShare",
+        "sellImbalanceShare",
+        "stackedImbalances",
+        "deltaSkew",
+        "volumeConcentration",
+        "pocShare",
+        "topDelta",
+        "bottomDelta",
+        "meanTradeSize",
+        "tradeSizeStddev",
+        "askBidSizeRatio",
+        "largeTradeShare",
+        "closePosition",
+    };
+    return names;
+}
+
+void OrderFlowExtractor::extract(const FootprintBar& bar, float* features) {
+    const auto& levels = bar.priceLevels;
+    size_t n = (levels.size() + kLanes - 1) / kLanes * kLanes;
+    bid_.assign(n, 0.0);
+    ask_.assign(n, 0.0);
+    position_.assign(n, 0.0);
+
+    // 按列展开档位数据，同时统计只需计数的字段
+    int64_t lowLevel = levels.empty() ? 0 : levels.front().level;
+    int64_t span = levels.empty() ? 0 : levels.back().level - lowLevel;
+    int bidCount = 0;
+    int askCount = 0;
+    int buyImbalances = 0;
+    int sellImbalances = 0;
+    int64_t largeSize = 0;
+    for (size_t i = 0; i < levels.size(); ++i) {
+        const auto& level = levels[i];
+        bid_[i] = static_cast<double>(level.bidSize);
+        ask_[i] = static_cast<double>(level.askSize);
+        position_[i] = span > 0 ? static_cast<double>(level.level - lowLevel) / static_cast<double>(span)
+                                : 0.5;
+        bidCount += level.bidCount;
+        askCount += level.askCount;
+        buyImbalances += level.buyImbalance;
+        sellImbalances += level.sellImbalance;
+        largeSize += level.largeBidSize + level.largeAskSize;
+    }
+
+    const double* bid = bid_.data();
+    const double* ask = ask_.data();
+    const double* position = position_.data();
+
+    double bidSum = sumLanes(n, [&](size_t i) { return bid[i]; });
+    double askSum = sumLanes(n, [&](size_t i) { return ask[i]; });
+    double volume = bidSum + askSum;
+    double squares = sumLanes(n, [&](size_t i) {
+        double v = bid[i] + ask[i];
+        return v * v;
+    });
+    double maxVolume = maxLanes(n, [&](size_t i) { return bid[i] + ask[i]; });
+    double bidMoment = sumLanes(n, [&](size_t i) { return bid[i] * position[i]; });
+    double askMoment = sumLanes(n, [&](size_t i) { return ask[i] * position[i]; });
+    double topDelta = sumLanes(n, [&](size_t i) {
+        return position[i] >= kTopThird ? ask[i] - bid[i] : 0.0;
+    });
+    double bottomDelta = sumLanes(n, [&](size_t i) {
+        return position[i] <= kBottomThird ? ask[i] - bid[i] : 0.0;
+    });
+
+    double trades = static_cast<double>(bar.tradesCount);
+    double meanSize = ratio(volume, trades);
+    double sizeVariance = std::max(ratio(bar.sizeSqLots, trades) - meanSize * meanSize, 0.0);
+    double tradedLevels = static_cast<double>(levels.size());
+
+    RuntimePrecision precision = bar.runtimePrecision();
+    double lotsPerUnit = precision.lotsPerUnit;
+    features[kFeatureVolume] = static_cast<float>(precision.fromLots(bar.volume));
+    features[kFeatureDelta] = static_cast<float>(precision.fromLots(bar.delta));
+    features[kFeatureDeltaRatio] = static_cast<float>(ratio(askSum - bidSum, volume));
+    features[kFeatureBuyImbalanceShare] = static_cast<float>(ratio(buyImbalances, tradedLevels));
+    features[kFeatureSellImbalanceShare] = static_cast<float>(ratio(sellImbalances, tradedLevels));
+    features[kFeatureStackedImbalances] = static_cast<float>(bar.stackedImbalances.size());
+    features[kFeatureDeltaSkew] =
+        static_cast<float>(ratio(askMoment, askSum) - ratio(bidMoment, bidSum));
+    features[kFeatureVolumeConcentration] = static_cast<float>(ratio(squares, volume * volume));
+    features[kFeaturePocShare] = static_cast<float>(ratio(maxVolume, volume));
+    features[kFeatureTopDelta] = static_cast<float>(topDelta / lotsPerUnit);
+    features[kFeatureBottomDelta] = static_cast<float>(bottomDelta / lotsPerUnit);
+    features[kFeatureMeanTradeSize] = static_cast<float>(meanSize / lotsPerUnit);
+    features[kFeatureTradeSizeStddev] = static_cast<float>(std::sqrt(sizeVariance) / lotsPerUnit);
+    features[kFeatureAskBidSizeRatio] =
+        static_cast<float>(ratio(ratio(askSum, askCount), ratio(bidSum, bidCount)));
+    features[kFeatureLargeTradeShare] = static_cast<float>(ratio(static_cast<double>(largeSize), volume));
+    features[kFeatureClosePosition] =
+        bar.high > bar.low ? static_cast<float>((bar.close - bar.low) / (bar.high - bar.low)) : 0.5f;
+}
+
+void writeFeatureTable(const std::string& filename, const std::vector<FootprintBar>& bars) {
+    // 按行计算后分散到各列
+    std::vector<int64_t> timestamps;
+    timestamps.reserve(bars.size());
+    std::vector<std::vector<float>> columns(kFeatureCount, std::vector<float>(bars.size()));
+    OrderFlowExtractor extractor;
+    float row[kFeatureCount];
+    for (size_t i = 0; i < bars.size(); ++i) {
+        timestamps.push_back(bars[i].timestamp);
+        extractor.extract(bars[i], row);
+        for (size_t f = 0; f < kFeatureCount; ++f) {
+            columns[f][i] = row[f];
+        }
+    }
+
+    std::ofstream outfile(filename, std::ios::binary);
+    if (!outfile) {
+        throw std::runtime_error("Failed to open output file: " + filename);
+    }
+    outfile.write("OFFT", 4);
+    writeValue(outfile, static_cast<uint32_t>(kFeatureCount));
+    writeValue(outfile, static_cast<uint64_t>(bars.size()));
+    for (const char* name : orderFlowFeatureNames()) {
+        outfile.write(name, static_cast<std::streamsize>(std::char_traits<char>::length(name) + 1));
+    }
+    writeColumn(outfile, timestamps);
+    for (const auto& column : columns) {
+        writeColumn(outfile, column);
+    }
+}
+
+} // namespace trading
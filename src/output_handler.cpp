@@ -1,7 +1,9 @@
 #include "output_handler.h"
+#include "bar_policy.h"
 #include "json.hpp"
 #include <fstream>
 #include <filesystem>
+#include <optional>
 
 namespace trading {
 
@@ -20,7 +22,8 @@ std::unique_ptr<OutputHandler> OutputHandler::create(const std::string& format)
 void JsonOutputHandler::write(
     const std::string& filename,
     const std::vector<FootprintBar>& bars,
-    [[maybe_unused]] const SymbolConfig& config) {
+    const SymbolConfig& config,
+    const FootprintBar* previous) {
     
     fs::path outputPath = filename;
     outputPath.replace_extension(".json");
@@ -29,8 +32,43 @@ void JsonOutputHandler::write(
     fs::create_directories(outputPath.parent_path());
     
     json outputJson;
+    int64_t lastTimestamp = 0;
+    int seq = 0;
+    std::optional<TimeBarPolicy> grid;  // 与构建时相同的K线边界
     for (const auto& bar : bars) {
-        outputJson[std::to_string(bar.timestamp)] = json::parse(bar.toJson());
+        // 时间K线之间缺失的时间段按需补占位K线，previous 可能来自上一个文件
+        if (config.fillGaps && previous != nullptr && bar.duration > 0) {
+            if (!grid) {
+                SymbolConfig frameConfig = config;
+                frameConfig.duration = bar.duration;
+                grid.emplace(frameConfig);
+            }
+            grid->openAt(previous->timestamp);
+            // 同一段空档内的占位K线只有时间不同，复用同一根；跨入新session时session累计值归零
+            int64_t session = previous->timestamp / config.sessionDuration;
+            FootprintBar gap = FootprintBar::placeholder(*previous, grid->end, true);
+            for (int64_t ts = grid->end; ts < bar.timestamp; ts = grid->end) {
+                if (ts / config.sessionDuration != session) {
+                    session = ts / config.sessionDuration;
+                    gap = FootprintBar::placeholder(*previous, ts, false);
+                }
+                gap.timestamp = ts;
+                gap.openTime = ts;
+                gap.closeTime = ts;
+                outputJson[std::to_string(ts)] = gap.toJsonObject();
+                grid->openAt(ts);
+            }
+        }
+        previous = &bar;
+
+        // 非时间K线可能在同一秒内开始多根，追加序号区分
+        std::string key = std::to_string(bar.timestamp);
+        seq = bar.timestamp == lastTimestamp ? seq + 1 : 0;
+        lastTimestamp = bar.timestamp;
+        if (seq > 0) {
+            key.append("_").append(std::to_string(seq));
+        }
+        outputJson[key] = bar.toJsonObject(config.fillEmptyLevels);
     }
     
     std::ofstream outFile(outputPath);
@@ -44,7 +82,8 @@ void JsonOutputHandler::write(
 void CsvOutputHandler::write(
     const std::string& filename,
     const std::vector<FootprintBar>& bars,
-    const SymbolConfig& config) {
+    const SymbolConfig& config,
+    const FootprintBar* previous) {
     
     // TODO: Implement CSV output format
     throw std::runtime_error("CSV output format not implemented yet");
@@ -1,13 +1,56 @@
 #include "processor.h"
+#include "heatmap_tensor.h"
+#include "order_flow_features.h"
 #include "io_utils.h"
 #include <filesystem>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <semaphore>
+#include <thread>
+#include "json.hpp"
 
 namespace trading {
 
 namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+namespace {
+constexpr int kMaxThreadCount = 64;
+
+// 由延续的累加值设置K线的累计delta和session VWAP
+void applySessionValues(const DeltaCarry& carry, FootprintBar& bar) {
+    bar.cumulativeDelta = carry.cumulativeDelta;
+    bar.sessionDelta = carry.sessionDelta;
+    if (carry.sessionVolume > 0) {
+        double sessionVolume = static_cast<double>(carry.sessionVolume);
+        bar.sessionVwap = carry.sessionPriceVolume / sessionVolume;
+        double variance = carry.sessionPriceSqVolume / sessionVolume -
+                          bar.sessionVwap * bar.sessionVwap;
+        bar.sessionStddev = std::sqrt(std::max(variance, 0.0));
+    } else {
+        bar.sessionVwap = bar.close;
+        bar.sessionStddev = 0.0;
+    }
+}
+
+// 还原上一个文件最后输出的K线中补齐空档需要的字段
+FootprintBar carriedBar(const DeltaCarry& carry, int64_t duration, const SymbolConfig& config) {
+    FootprintBar bar(static_cast<int>(duration), carry.lastScale, config.volumePrecision,
+                     config.pricePrecision, config.lotPrecision);
+    bar.timestamp = carry.lastTimestamp;
+    bar.openTime = carry.lastTimestamp;
+    bar.closeTime = carry.lastTimestamp;
+    bar.open = bar.high = bar.low = bar.close = carry.lastClose;
+    applySessionValues(carry, bar);
+    return bar;
+}
+} // namespace
 
 void ProcessingStats::print(const std::string& filename) const {
     std::cout << "\nCompleted processing " << filename << "\n"
@@ -27,24 +70,210 @@ Processor::Processor(
     : fetcher_(std::move(fetcher))
     , outputHandler_(std::move(outputHandler))
     , processConfig_(processConfig)
-    , symbolConfig_(symbolConfig) {}
+    , symbolConfig_(symbolConfig)
+    , footprintGenerator_(selectFootprintGenerator(symbolConfig)) {}
+
+fs::path Processor::outputPath(const std::string& dir, const std::string& filename,
+                              const std::string& extension) const {
+    fs::path name = fs::path(filename).filename();
+    if (!extension.empty()) {
+        name.replace_extension(extension);
+    }
+    return fs::path(processConfig_.outputDir) / dir / name;
+}
+
+fs::path Processor::footprintPath(const std::string& filename, int64_t duration) const {
+    // 主周期沿用footprint目录，其他周期写入footprint_<duration>
+    std::string dir = duration == symbolConfig_.duration
+        ? "footprint" : "footprint_" + std::to_string(duration);
+    return outputPath(dir, filename, ".json");
+}
+
+std::string SeriesCarry::toJson() const {
+    json j;
+    json deltasJson = json::array();
+    for (const auto& carry : deltas) {
+        deltasJson.push_back({
+            {"cumulativeDelta", carry.cumulativeDelta},
+            {"sessionDelta", carry.sessionDelta},
+            {"session", carry.session},
+            {"sessionVolume", carry.sessionVolume},
+            {"sessionPriceVolume", carry.sessionPriceVolume},
+            {"sessionPriceSqVolume", carry.sessionPriceSqVolume},
+            {"lastTimestamp", carry.lastTimestamp},
+            {"lastClose", carry.lastClose},
+            {"lastScale", carry.lastScale},
+        });
+    }
+    j["deltas"] = deltasJson;
+    json tails = json::array();
+    for (const auto& bar : tailBars) {
+        tails.push_back(bar.toState());
+    }
+    j["tailBars"] = tails;
+    return j.dump(4);
+}
+
+SeriesCarry SeriesCarry::fromJson(const std::string& content) {
+    json j = json::parse(content);
+    SeriesCarry carry;
+    for (const auto& item : j.at("deltas")) {
+        DeltaCarry delta;
+        delta.cumulativeDelta = item.at("cumulativeDelta").get<int64_t>();
+        delta.sessionDelta = item.at("sessionDelta").get<int64_t>();
+        delta.session = item.at("session").get<int64_t>();
+        delta.sessionVolume = item.value("sessionVolume", int64_t{0});
+        delta.sessionPriceVolume = item.value("sessionPriceVolume", 0.0);
+        delta.sessionPriceSqVolume = item.value("sessionPriceSqVolume", 0.0);
+        delta.lastTimestamp = item.value("lastTimestamp", int64_t{0});
+        delta.lastClose = item.value("lastClose", 0.0);
+        delta.lastScale = item.value("lastScale", 0);
+        carry.deltas.push_back(delta);
+    }
+    if (j.contains("tailBars")) {
+        for (const auto& state : j.at("tailBars")) {
+            carry.tailBars.push_back(FootprintBar::fromState(state));
+        }
+    }
+    return carry;
+}
 
 void Processor::processFile(const std::string& filename) {
-    fs::path footprintPath = fs::path(processConfig_.outputDir) / "footprint" / 
-                            fs::path(filename).filename().replace_extension(".json");
-    fs::path aggTradePath = fs::path(processConfig_.outputDir) / "aggtrade" / 
-                           fs::path(filename).filename();
-    
-    // 检查输出文件是否已存在
-    if (fs::exists(footprintPath) && fs::exists(aggTradePath)) {
-        std::cout << "Skip existing file: " << filename << std::endl;
-        return;
+    std::promise<SeriesCarry> start;
+    start.set_value(SeriesCarry{});
+    std::promise<SeriesCarry> next;
+    processFile(filename, start.get_future().share(), next, false);
+}
+
+struct Processor::FileChain {
+    Processor* processor;
+    std::vector<std::string> files;
+    std::vector<std::promise<SeriesCarry>> carries;
+    std::shared_future<SeriesCarry> previous;
+    size_t next{0};
+
+    FileChain(Processor* processor, std::vector<std::string> filenames)
+        : processor(processor)
+        , files(std::move(filenames))
+        , carries(files.size() + 1) {
+        std::sort(files.begin(), files.end());
+        carries[0].set_value(SeriesCarry{});
+        previous = carries[0].get_future().share();
     }
+};
 
-    std::cout << "Processing: " << filename << std::endl;
-    ProcessingStats stats;
+void Processor::runChains(std::vector<FileChain>& chains, int threadCount) {
+    threadCount = std::clamp(threadCount, 1, kMaxThreadCount);
+    std::counting_semaphore<kMaxThreadCount> sem(threadCount);
+    std::vector<std::thread> threads;
+
+    // 轮流从各品种取下一个文件。同一品种内按文件顺序占用线程槽，
+    // 等待前序文件的线程总能先拿到槽位
+    bool pending = true;
+    while (pending) {
+        pending = false;
+        for (auto& chain : chains) {
+            if (chain.next >= chain.files.size()) continue;
+            pending = true;
+            size_t i = chain.next++;
+            sem.acquire();
+            std::shared_future<SeriesCarry> next = chain.carries[i + 1].get_future().share();
+            threads.emplace_back([&sem, &chain, previous = chain.previous, i]() {
+                chain.processor->processFile(chain.files[i], previous, chain.carries[i + 1],
+                                             i + 1 < chain.files.size());
+                sem.release();
+            });
+            chain.previous = next;
+        }
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+void Processor::processFiles(std::vector<std::string> filenames) {
+    std::vector<FileChain> chains;
+    chains.emplace_back(this, std::move(filenames));
+    runChains(chains, processConfig_.threadCount);
+}
+
+void Processor::processBatch(const ProcessConfig& processConfig,
+                             const SymbolRegistry& registry,
+                             const std::string& exchange,
+                             const std::string& format,
+                             std::vector<std::string> filenames) {
+    std::map<std::string, std::vector<std::string>> filesBySymbol;
+    for (auto& filename : filenames) {
+        std::string symbol = SymbolRegistry::symbolFromFilename(filename);
+        filesBySymbol[symbol].push_back(std::move(filename));
+    }
+
+    std::vector<std::unique_ptr<Processor>> processors;
+    std::vector<FileChain> chains;
+    chains.reserve(filesBySymbol.size());
+    for (auto& [symbol, files] : filesBySymbol) {
+        // 未注册品种的价格数量级未知，按默认精度处理会得到看似正常但分档错误的输出
+        if (!registry.contains(symbol)) {
+            std::cerr << "No config for symbol " << symbol << ", skipping " << files.size()
+                      << " file(s)" << std::endl;
+            continue;
+        }
+        processors.push_back(std::make_unique<Processor>(
+            DataFetcher::create(exchange), OutputHandler::create(format),
+            processConfig, registry.get(symbol)));
+        chains.emplace_back(processors.back().get(), std::move(files));
+    }
+    runChains(chains, processConfig.threadCount);
+}
+
+void Processor::processFile(const std::string& filename,
+                            const std::shared_future<SeriesCarry>& previous,
+                            std::promise<SeriesCarry>& next,
+                            bool hasSuccessor) {
+    auto timeframes = symbolConfig_.timeframes();
+    std::vector<fs::path> footprintPaths;
+    for (auto duration : timeframes) {
+        footprintPaths.push_back(footprintPath(filename, duration));
+    }
+    fs::path aggTradePath = outputPath("aggtrade", filename, "");
+    fs::path cvdPath = outputPath("cvd", filename, ".csv");
+    fs::path statePath = outputPath("state", filename, ".json");
+    bool snapshotsEnabled = symbolConfig_.snapshotInterval > 0 || symbolConfig_.snapshotTrades > 0;
+    fs::path snapshotPath = outputPath("snapshot", filename, ".jsonl");
+    bool heatmapEnabled = symbolConfig_.heatmapLevels > 0;
+    fs::path heatmapPath = outputPath("heatmap", filename, ".bin");
+    fs::path featurePath = outputPath("features", filename, ".bin");
+    std::vector<fs::path> profilePaths;
+    for (auto duration : symbolConfig_.profileDurations) {
+        profilePaths.push_back(outputPath("profile_" + std::to_string(duration), filename, ".bin"));
+    }
     
+    auto allExist = [](const std::vector<fs::path>& paths) {
+        return std::all_of(paths.begin(), paths.end(),
+                           [](const fs::path& path) { return fs::exists(path); });
+    };
+    bool footprintsExist = allExist(footprintPaths);
+
+    bool carried = false;
     try {
+        // 检查输出文件是否已存在，文件末尾状态从state中恢复
+        if (footprintsExist && allExist(profilePaths) && fs::exists(aggTradePath) &&
+            fs::exists(cvdPath) && fs::exists(statePath) &&
+            (!snapshotsEnabled || fs::exists(snapshotPath)) &&
+            (!heatmapEnabled || fs::exists(heatmapPath)) &&
+            (!symbolConfig_.orderFlowFeatures || fs::exists(featurePath))) {
+            std::cout << "Skip existing file: " << filename << std::endl;
+            std::ifstream stateFile(statePath);
+            std::string content((std::istreambuf_iterator<char>(stateFile)),
+                                std::istreambuf_iterator<char>());
+            next.set_value(SeriesCarry::fromJson(content));
+            return;
+        }
+
+        std::cout << "Processing: " << filename << std::endl;
+        ProcessingStats stats;
+
         auto parseStart = std::chrono::high_resolution_clock::now();
         auto trades = parseFile(filename, stats);
         auto parseEnd = std::chrono::high_resolution_clock::now();
@@ -54,19 +283,104 @@ void Processor::processFile(const std::string& filename) {
         
         auto writeStart = std::chrono::high_resolution_clock::now();
         
-        // 生成并写入footprint
-        if (!fs::exists(footprintPath)) {
-            auto footprints = generateFootprint(trades);
-            fs::create_directories(footprintPath.parent_path());
-            outputHandler_->write(footprintPath.string(), footprints, symbolConfig_);
+        // 一次生成所有周期的footprint，累计值需要用到，始终生成
+        std::vector<BarSnapshot> snapshots;
+        bool writeSnapshotFile = snapshotsEnabled && !fs::exists(snapshotPath);
+        std::vector<AggTrade> aggTrades;
+        bool writeAggTradeFile = !fs::exists(aggTradePath);
+        auto footprints = generateFootprint(trades, writeSnapshotFile ? &snapshots : nullptr,
+                                            writeAggTradeFile ? &aggTrades : nullptr);
+        stats.aggregatedTrades = aggTrades.size();
+        int64_t lastTradeTime = trades.empty() ? 0 : trades.back().time;
+        trades = std::vector<Trade>();
+
+        // 等待前一个文件的末尾状态，尽早把本文件的末尾状态交给下一个文件
+        const SeriesCarry& previousCarry = previous.get();
+        stitchTailBars(footprints, previousCarry.tailBars);
+
+        // 末尾K线的时间段超出最后一笔成交所在的秒时可能延续到下一个文件，
+        // 交给下一个文件合并后再输出；在本文件内结束的K线照常输出。
+        // 不需要保留的周期放一根空K线占位
+        std::vector<FootprintBar> tailBars;
+        if (hasSuccessor && symbolConfig_.barType == BarType::Time &&
+            !footprints.front().empty()) {
+            SymbolConfig frameConfig = symbolConfig_;
+            for (size_t i = 0; i < footprints.size(); ++i) {
+                auto& bars = footprints[i];
+                frameConfig.duration = timeframes[i];
+                TimeBarPolicy policy(frameConfig);
+                policy.openAt(bars.back().timestamp);
+                if (policy.end > lastTradeTime + 1) {
+                    tailBars.push_back(std::move(bars.back()));
+                    bars.pop_back();
+                } else {
+                    tailBars.emplace_back();
+                }
+            }
+        }
+
+        SeriesCarry carry;
+        carry.deltas = applyCarry(footprints, previousCarry.deltas);
+        carry.tailBars = std::move(tailBars);
+        next.set_value(carry);
+        carried = true;
+
+        if (writeSnapshotFile) {
+            fs::create_directories(snapshotPath.parent_path());
+            writeSnapshots(snapshotPath.string(), snapshots);
+        }
+
+        // 由最细周期合并出各session的成交量分布，跨文件的session由各文件的部分合并
+        for (size_t i = 0; i < profilePaths.size(); ++i) {
+            if (fs::exists(profilePaths[i])) continue;
+            fs::create_directories(profilePaths[i].parent_path());
+            writeProfiles(profilePaths[i].string(),
+                          generateProfiles(footprints.front(), symbolConfig_.profileDurations[i]));
+        }
+
+        auto mainFrame = std::find(timeframes.begin(), timeframes.end(), symbolConfig_.duration);
+        const auto& mainBars = footprints[mainFrame - timeframes.begin()];
+
+        // 主周期的热力图张量和订单流特征按原始档位高度生成
+        if (heatmapEnabled && !fs::exists(heatmapPath)) {
+            fs::create_directories(heatmapPath.parent_path());
+            writeHeatmapTensor(heatmapPath.string(), mainBars, symbolConfig_.heatmapLevels);
+        }
+        if (symbolConfig_.orderFlowFeatures && !fs::exists(featurePath)) {
+            fs::create_directories(featurePath.parent_path());
+            writeFeatureTable(featurePath.string(), mainBars);
+        }
+
+        // 按K线自身价格区间放大档位高度只作用于输出，profile和state保持原始档位。
+        // 时间K线从上一个文件的最后一根K线接续，文件开头的空档也能补齐
+        for (size_t i = 0; i < timeframes.size(); ++i) {
+            if (fs::exists(footprintPaths[i])) continue;
+            adaptLevelScale(footprints[i]);
+            std::optional<FootprintBar> head;
+            if (symbolConfig_.barType == BarType::Time && i < previousCarry.deltas.size() &&
+                previousCarry.deltas[i].lastTimestamp > 0) {
+                head = carriedBar(previousCarry.deltas[i], timeframes[i], symbolConfig_);
+            }
+            fs::create_directories(footprintPaths[i].parent_path());
+            outputHandler_->write(footprintPaths[i].string(), footprints[i], symbolConfig_,
+                                  head ? &*head : nullptr);
         }
         
-        // 生成并写入aggtrade
-        if (!fs::exists(aggTradePath)) {
-            auto aggTrades = generateAggTrades(trades);
+        if (writeAggTradeFile) {
             fs::create_directories(aggTradePath.parent_path());
             writeAggTrades(aggTradePath.string(), aggTrades);
         }
+
+        // 主周期的紧凑CVD序列
+        if (!fs::exists(cvdPath)) {
+            fs::create_directories(cvdPath.parent_path());
+            writeCvd(cvdPath.string(), mainBars);
+        }
+
+        // state最后写入，作为本文件处理完成的标记
+        fs::create_directories(statePath.parent_path());
+        std::ofstream stateFile(statePath);
+        stateFile << carry.toJson();
         
         auto writeEnd = std::chrono::high_resolution_clock::now();
         stats.writeTime = std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -76,6 +390,10 @@ void Processor::processFile(const std::string& filename) {
     }
     catch (const std::exception& e) {
         std::cerr << "Error processing " << filename << ": " << e.what() << std::endl;
+        if (!carried) {
+            // 出错的文件不计入累计值，避免后续文件一直等待
+            next.set_value(previous.get());
+        }
     }
 }
 
@@ -85,6 +403,7 @@ std::vector<Trade> Processor::parseFile(
     
     std::vector<Trade> trades;
     io::FileReader reader(filename);
+    RuntimePrecision precision(symbolConfig_);  // 数量按品种的lot精度换算
     
     // 先读取第一个chunk
     if (!reader.readChunk()) {
@@ -127,6 +446,7 @@ std::vector<Trade> Processor::parseFile(
         reader.advance(next_p - reader.current());
         
         trade.time /= 1000; // 转换为秒
+        trade.lots = precision.toLots(trade.size);
         trades.push_back(trade);
         stats.totalTrades++;
     }
@@ -137,111 +457,90 @@ std::vector<Trade> Processor::parseFile(
     return trades;
 }
 
-std::vector<FootprintBar> Processor::generateFootprint(
-    const std::vector<Trade>& trades) {
-    
-    std::vector<FootprintBar> footprintList;
-    if (trades.empty()) {
-        return footprintList;
-    }
+std::vector<std::vector<FootprintBar>> Processor::generateFootprint(
+    const std::vector<Trade>& trades, std::vector<BarSnapshot>* snapshots,
+    std::vector<AggTrade>* aggTrades) {
+    return footprintGenerator_(trades, symbolConfig_, processConfig_.footprintThreadCount,
+                               snapshots, aggTrades);
+}
 
-    auto currentBar = std::make_unique<FootprintBar>(
-        symbolConfig_.duration,
-        symbolConfig_.scale,
-        symbolConfig_.volumePrecision,
-        symbolConfig_.pricePrecision
-    );
-
-    for (const auto& trade : trades) {
-        if (!currentBar->handleTick(trade)) {
-            // 当前K线结束，保存并创建新的
-            currentBar->endHandleTick();
-            footprintList.push_back(*currentBar);
-            
-            // 创建新的K线
-            currentBar = std::make_unique<FootprintBar>(
-                symbolConfig_.duration,
-                symbolConfig_.scale,
-                symbolConfig_.volumePrecision,
-                symbolConfig_.pricePrecision
-            );
-            
-            if (!currentBar->handleTick(trade)) {
-                std::cerr << "Failed to handle trade in new bar" << std::endl;
-                continue;
+void Processor::stitchTailBars(std::vector<std::vector<FootprintBar>>& footprints,
+                               const std::vector<FootprintBar>& tailBars) const {
+    for (size_t i = 0; i < tailBars.size() && i < footprints.size(); ++i) {
+        auto& bars = footprints[i];
+        const auto& tail = tailBars[i];
+        if (tail.timestamp == 0) {
+            continue;
+        }
+        if (!bars.empty() && bars.front().timestamp == tail.timestamp) {
+            FootprintBar head = std::move(bars.front());
+            bars.front() = tail;
+            bars.front().merge(head);
+            bars.front().computeAverages();
+            auto& topTrades = bars.front().topTrades;
+            if (topTrades.size() > static_cast<size_t>(symbolConfig_.topTradeCount)) {
+                topTrades.resize(static_cast<size_t>(symbolConfig_.topTradeCount));
             }
+            bars.front().computeValueArea(symbolConfig_.valueAreaPercent);
+            bars.front().computeImbalances(symbolConfig_.imbalanceRatio,
+                                           symbolConfig_.stackedImbalanceLevels);
+        } else {
+            bars.insert(bars.begin(), tail);
         }
     }
-
-    // 处理最后一个K线
-    if (currentBar->timestamp != 0) {
-        currentBar->endHandleTick();
-        footprintList.push_back(*currentBar);
-    }
-
-    return footprintList;
 }
 
-std::vector<AggTrade> Processor::generateAggTrades(const std::vector<Trade>& trades) {
-    std::vector<AggTrade> aggregated;
-    if (trades.empty()) {
-        return aggregated;
-    }
-
-    AggTrade* buySideAgg = nullptr;
-    AggTrade* sellSideAgg = nullptr;
-    std::unique_ptr<AggTrade> buySideHolder;
-    std::unique_ptr<AggTrade> sellSideHolder;
-
-    for (const auto& trade : trades) {
-        // 计算时间戳
-        int64_t ts = (trade.time * 1000 / symbolConfig_.preAggDuration) * symbolConfig_.preAggDuration;
-
-        AggTrade** opAgg = trade.isBuyerMaker ? &buySideAgg : &sellSideAgg;
-        std::unique_ptr<AggTrade>& holder = trade.isBuyerMaker ? buySideHolder : sellSideHolder;
-
-        // 如果存在聚合记录但时间不同，保存并重置
-        if (*opAgg && (*opAgg)->time != ts) {
-            aggregated.push_back(**opAgg);
-            *opAgg = nullptr;
-            holder.reset();
-        }
-
-        // 创建新的聚合记录或更新现有记录
-        if (*opAgg == nullptr) {
-            holder = std::make_unique<AggTrade>();
-            *opAgg = holder.get();
-            (*opAgg)->id = trade.id;
-            (*opAgg)->price = trade.price;
-            (*opAgg)->qty = trade.qty;
-            (*opAgg)->quoteQty = trade.quoteQty;
-            (*opAgg)->time = ts;
-            (*opAgg)->isBuyerMaker = trade.isBuyerMaker;
-            (*opAgg)->count = 1;
-        } else {
-            (*opAgg)->qty += trade.qty;
-            (*opAgg)->quoteQty += trade.quoteQty;
-            (*opAgg)->count++;
+std::vector<DeltaCarry> Processor::applyCarry(
+    std::vector<std::vector<FootprintBar>>& footprints,
+    const std::vector<DeltaCarry>& deltas) const {
+    std::vector<DeltaCarry> end;
+    for (size_t i = 0; i < footprints.size(); ++i) {
+        DeltaCarry running = i < deltas.size() ? deltas[i] : DeltaCarry{};
+        for (auto& bar : footprints[i]) {
+            int64_t session = bar.timestamp / symbolConfig_.sessionDuration *
+                              symbolConfig_.sessionDuration;
+            if (session != running.session) {
+                running.session = session;
+                running.sessionDelta = 0;
+                running.sessionVolume = 0;
+                running.sessionPriceVolume = 0.0;
+                running.sessionPriceSqVolume = 0.0;
+            }
+            running.cumulativeDelta += bar.delta;
+            running.sessionDelta += bar.delta;
+            running.sessionVolume += bar.volume;
+            running.sessionPriceVolume += bar.priceVolume;
+            running.sessionPriceSqVolume += bar.priceSqVolume;
+            running.lastTimestamp = bar.timestamp;
+            running.lastClose = bar.close;
+            running.lastScale = bar.scale * levelScaleFactor(bar);
+            applySessionValues(running, bar);
         }
+        end.push_back(running);
     }
+    return end;
+}
 
-    // 添加最后的聚合记录
-    if (buySideAgg) {
-        aggregated.push_back(*buySideAgg);
+int Processor::levelScaleFactor(const FootprintBar& bar) const {
+    if (symbolConfig_.targetLevels <= 0 || bar.priceLevels.empty()) {
+        return 1;
     }
-    if (sellSideAgg) {
-        aggregated.push_back(*sellSideAgg);
+    int64_t range = bar.priceLevels.back().level - bar.priceLevels.front().level + 1;
+    if (range <= symbolConfig_.targetLevels) {
+        return 1;
     }
+    // 向上取整，每根K线的档位数不超过约 targetLevels，实际档位高度记录在 bar.scale
+    return static_cast<int>((range + symbolConfig_.targetLevels - 1) / symbolConfig_.targetLevels);
+}
 
-    // 按时间和ID排序
-    std::sort(aggregated.begin(), aggregated.end(),
-              [](const AggTrade& a, const AggTrade& b) {
-                  if (a.time == b.time)
-                      return a.id < b.id;
-                  return a.time < b.time;
-              });
-
-    return aggregated;
+void Processor::adaptLevelScale(std::vector<FootprintBar>& bars) const {
+    for (auto& bar : bars) {
+        int factor = levelScaleFactor(bar);
+        if (factor <= 1) continue;
+        bar.coarsen(factor);
+        bar.computeValueArea(symbolConfig_.valueAreaPercent);
+        bar.computeImbalances(symbolConfig_.imbalanceRatio, symbolConfig_.stackedImbalanceLevels);
+    }
 }
 
 void Processor::writeAggTrades(const std::string& filename, const std::vector<AggTrade>& aggTrades) {
@@ -264,6 +563,8 @@ void Processor::writeAggTrades(const std::string& filename, const std::vector<Ag
 
     // 快速整数和浮点数格式化
     char numBuf[32];
+    int volumePrecision = symbolConfig_.volumePrecision;
+    int lotPrecision = symbolConfig_.lotPrecision;
     
     for (const auto& trade : aggTrades) {
         line.clear();
@@ -279,7 +580,7 @@ void Processor::writeAggTrades(const std::string& filename, const std::vector<Ag
         line += ',';
         
         // qty
-        p = io::FastFormatter::formatDouble(numBuf, trade.qty, symbolConfig_.volumePrecision);
+        p = io::FastFormatter::formatDouble(numBuf, roundLotsTo(trade.qty, lotPrecision, volumePrecision), volumePrecision);
         line.append(numBuf, p - numBuf);
         line += ',';
         
@@ -308,4 +609,74 @@ void Processor::writeAggTrades(const std::string& filename, const std::vector<Ag
     outfile.flush();
 }
 
-} // namespace trading 
\ No newline at end of file
+std::vector<VolumeProfile> Processor::generateProfiles(const std::vector<FootprintBar>& bars,
+                                                       int64_t duration) const {
+    std::vector<VolumeProfile> profiles;
+    for (const auto& bar : bars) {
+        int64_t offset = bar.timestamp - symbolConfig_.profileAnchor;
+        int64_t session = offset / duration * duration - (offset % duration < 0 ? duration : 0) +
+                          symbolConfig_.profileAnchor;
+        if (profiles.empty() || profiles.back().sessionStart != session) {
+            profiles.emplace_back(session, duration, symbolConfig_.scale,
+                                  symbolConfig_.volumePrecision, symbolConfig_.pricePrecision,
+                                  symbolConfig_.lotPrecision);
+        }
+        profiles.back().addBar(bar);
+    }
+    return profiles;
+}
+
+void Processor::writeCvd(const std::string& filename, const std::vector<FootprintBar>& bars) {
+    std::ofstream outfile(filename, std::ios::binary);
+    if (!outfile) {
+        throw std::runtime_error("Failed to open output file: " + filename);
+    }
+
+    outfile << "timestamp,delta,cvd,session_cvd\n";
+
+    std::string line;
+    line.reserve(96);
+    char numBuf[32];
+    int volumePrecision = symbolConfig_.volumePrecision;
+    int lotPrecision = symbolConfig_.lotPrecision;
+
+    for (const auto& bar : bars) {
+        line.clear();
+
+        auto p = io::FastFormatter::formatInt(numBuf, bar.timestamp);
+        line.append(numBuf, p - numBuf);
+        line += ',';
+
+        p = io::FastFormatter::formatDouble(numBuf, roundLotsTo(bar.delta, lotPrecision, volumePrecision), volumePrecision);
+        line.append(numBuf, p - numBuf);
+        line += ',';
+
+        p = io::FastFormatter::formatDouble(numBuf, roundLotsTo(bar.cumulativeDelta, lotPrecision, volumePrecision), volumePrecision);
+        line.append(numBuf, p - numBuf);
+        line += ',';
+
+        p = io::FastFormatter::formatDouble(numBuf, roundLotsTo(bar.sessionDelta, lotPrecision, volumePrecision), volumePrecision);
+        line.append(numBuf, p - numBuf);
+        line += '\n';
+
+        outfile.write(line.data(), line.size());
+    }
+
+    outfile.flush();
+}
+
+void Processor::writeSnapshots(const std::string& filename,
+                               const std::vector<BarSnapshot>& snapshots) {
+    std::ofstream outfile(filename, std::ios::binary);
+    if (!outfile) {
+        throw std::runtime_error("Failed to open output file: " + filename);
+    }
+
+    // 每行一个快照，档位只包含相对上一个快照有变化的部分
+    RuntimePrecision precision(symbolConfig_);
+    for (const auto& snapshot : snapshots) {
+        outfile << snapshot.toJson(precision) << '\n';
+    }
+}
+
+} // namespace trading
@@ -0,0 +1,358 @@
+#include "session_calendar.h"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace trading {
+
+namespace {
+
+constexpr int64_t kSecondsPerDay = 86400;
+
+int64_t floorDiv(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+// 公历日期与自1970-01-01天数的换算
+int64_t daysFromCivil(int64_t y, int m, int d) {
+    y -= m <= 2;
+    int64_t era = floorDiv(y, 400);
+    int64_t yoe = y - era * 400;
+    int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+int64_t yearFromDays(int64_t days) {
+    days += 719468;
+    int64_t era = floorDiv(days, 146097);
+    int64_t doe = days - era * 146097;
+    int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int64_t mp = (5 * doy + 2) / 153;
+    return yoe + era * 400 + (mp >= 10 ? 1 : 0);
+}
+
+int daysInMonth(int64_t y, int m) {
+    return static_cast<int>(daysFromCivil(m == 12 ? y + 1 : y, m == 12 ? 1 : m + 1, 1) -
+                            daysFromCivil(y, m, 1));
+}
+
+#if !TRADING_HAS_CHRONO_TZDB
+constexpr const char* kZoneInfoDir = "/usr/share/zoneinfo/";
+
+int64_t readBigEndian(const std::string& data, size_t pos, size_t size) {
+    if (pos + size > data.size()) {
+        throw std::runtime_error("Truncated time zone file");
+    }
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; i++) {
+        value = (value << 8) | static_cast<unsigned char>(data[pos + i]);
+    }
+    // 按位宽做符号扩展
+    if (size < 8 && (value >> (size * 8 - 1)) & 1) {
+        value |= ~uint64_t{0} << (size * 8);
+    }
+    return static_cast<int64_t>(value);
+}
+
+// POSIX TZ字符串的简单解析器
+class PosixReader {
+public:
+    explicit PosixReader(const std::string& text) : text_(text) {}
+
+    bool done() const { return pos_ >= text_.size(); }
+    bool consume(char c) {
+        if (pos_ < text_.size() && text_[pos_] == c) {
+            pos_++;
+            return true;
+        }
+        return false;
+    }
+    bool atOffset() const {
+        return pos_ < text_.size() &&
+               (std::isdigit(static_cast<unsigned char>(text_[pos_])) ||
+                text_[pos_] == '+' || text_[pos_] == '-');
+    }
+
+    void name() {
+        if (consume('<')) {
+            while (pos_ < text_.size() && text_[pos_] != '>') pos_++;
+            if (!consume('>')) fail();
+            return;
+        }
+        size_t start = pos_;
+        while (pos_ < text_.size() && std::isalpha(static_cast<unsigned char>(text_[pos_]))) pos_++;
+        if (pos_ == start) fail();
+    }
+
+    int64_t number() {
+        size_t start = pos_;
+        int64_t value = 0;
+        while (pos_ < text_.size() && std::isdigit(static_cast<unsigned char>(text_[pos_]))) {
+            value = value * 10 + (text_[pos_++] - '0');
+        }
+        if (pos_ == start) fail();
+        return value;
+    }
+
+    // [+-]hh[:mm[:ss]]，返回秒数
+    int64_t time() {
+        int64_t sign = 1;
+        if (consume('-')) {
+            sign = -1;
+        } else {
+            consume('+');
+        }
+        int64_t seconds = number() * 3600;
+        if (consume(':')) {
+            seconds += number() * 60;
+            if (consume(':')) seconds += number();
+        }
+        return sign * seconds;
+    }
+
+    [[noreturn]] void fail() const {
+        throw std::runtime_error("Unsupported time zone rule: " + text_);
+    }
+
+private:
+    const std::string& text_;
+    size_t pos_{0};
+};
+
+#endif
+
+} // namespace
+
+TimeZone TimeZone::load(const std::string& name) {
+    if (name.empty() || name == "UTC") {
+        return TimeZone();
+    }
+#if TRADING_HAS_CHRONO_TZDB
+    TimeZone zone;
+    try {
+        zone.zone_ = std::chrono::locate_zone(name);
+    } catch (const std::runtime_error&) {
+        throw std::runtime_error("Unknown time zone: " + name);
+    }
+    return zone;
+#else
+    if (name.find("..") != std::string::npos || name.front() == '/') {
+        throw std::runtime_error("Invalid time zone: " + name);
+    }
+    std::ifstream file(kZoneInfoDir + name, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Unknown time zone: " + name);
+    }
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.size() < 44 || data.compare(0, 4, "TZif") != 0) {
+        throw std::runtime_error("Invalid time zone file: " + name);
+    }
+
+    // 版本2及以上跳过32位数据块，读取后面的64位数据块和POSIX规则
+    size_t pos = 0;
+    size_t timeSize = 4;
+    auto counts = [&](size_t header, int index) {
+        return static_cast<size_t>(readBigEndian(data, header + 20 + index * 4, 4));
+    };
+    auto blockSize = [&](size_t header, size_t width) {
+        return 44 + counts(header, 3) * (width + 1) + counts(header, 4) * 6 +
+               counts(header, 5) + counts(header, 2) * (width + 4) +
+               counts(header, 1) + counts(header, 0);
+    };
+    bool extended = data[4] >= '2';
+    if (extended) {
+        pos = blockSize(0, 4);
+        timeSize = 8;
+        if (data.compare(pos, 4, "TZif") != 0) {
+            throw std::runtime_error("Invalid time zone file: " + name);
+        }
+    }
+
+    size_t timeCount = counts(pos, 3);
+    size_t typeCount = counts(pos, 4);
+    if (typeCount == 0) {
+        throw std::runtime_error("Invalid time zone file: " + name);
+    }
+    size_t timesPos = pos + 44;
+    size_t indexPos = timesPos + timeCount * timeSize;
+    size_t typesPos = indexPos + timeCount;
+
+    std::vector<int64_t> typeOffsets(typeCount);
+    for (size_t i = 0; i < typeCount; i++) {
+        typeOffsets[i] = readBigEndian(data, typesPos + i * 6, 4);
+    }
+
+    TimeZone zone;
+    zone.initialOffset_ = typeOffsets[0];
+    zone.transitions_.reserve(timeCount);
+    zone.offsets_.reserve(timeCount);
+    for (size_t i = 0; i < timeCount; i++) {
+        size_t type = static_cast<size_t>(readBigEndian(data, indexPos + i, 1) & 0xff);
+        if (type >= typeCount) {
+            throw std::runtime_error("Invalid time zone file: " + name);
+        }
+        zone.transitions_.push_back(readBigEndian(data, timesPos + i * timeSize, timeSize));
+        zone.offsets_.push_back(typeOffsets[type]);
+    }
+    zone.stdOffset_ = zone.offsets_.empty() ? zone.initialOffset_ : zone.offsets_.back();
+
+    if (extended) {
+        size_t footer = pos + blockSize(pos, 8);
+        if (footer < data.size() && data[footer] == '\n') {
+            size_t footerEnd = data.find('\n', footer + 1);
+            if (footerEnd != std::string::npos && footerEnd > footer + 1) {
+                zone.parsePosixRule(data.substr(footer + 1, footerEnd - footer - 1));
+            }
+        }
+    }
+    return zone;
+#endif
+}
+
+#if !TRADING_HAS_CHRONO_TZDB
+void TimeZone::parsePosixRule(const std::string& rule) {
+    // std offset [dst [offset] [,start[/time],end[/time]]]，POSIX偏移西正东负
+    PosixReader reader(rule);
+    reader.name();
+    stdOffset_ = -reader.time();
+    if (reader.done()) {
+        return;
+    }
+    reader.name();
+    dstOffset_ = reader.atOffset() ? -reader.time() : stdOffset_ + 3600;
+
+    auto parseRule = [&](Rule& target) {
+        if (!reader.consume(',') || !reader.consume('M')) reader.fail();
+        target.month = static_cast<int>(reader.number());
+        if (!reader.consume('.')) reader.fail();
+        target.week = static_cast<int>(reader.number());
+        if (!reader.consume('.')) reader.fail();
+        target.weekday = static_cast<int>(reader.number());
+        if (target.month < 1 || target.month > 12 || target.week < 1 || target.week > 5 ||
+            target.weekday > 6) {
+            reader.fail();
+        }
+        if (reader.consume('/')) target.time = reader.time();
+    };
+    parseRule(dstStart_);
+    parseRule(dstEnd_);
+    hasRule_ = true;
+}
+#endif
+
+int64_t TimeZone::ruleOffsetAt(int64_t utc) const {
+    if (!hasRule_) {
+        return stdOffset_;
+    }
+    // 规则日期的本地时刻(自1970-01-01的秒数)
+    auto ruleTime = [](int64_t year, const Rule& rule) {
+        int64_t first = daysFromCivil(year, rule.month, 1);
+        int firstWeekday = static_cast<int>(((first + 4) % 7 + 7) % 7);  // 1970-01-01为周四
+        int day = 1 + (rule.weekday - firstWeekday + 7) % 7 + (rule.week - 1) * 7;
+        int last = daysInMonth(year, rule.month);
+        while (day > last) day -= 7;
+        return (first + day - 1) * kSecondsPerDay + rule.time;
+    };
+    int64_t year = yearFromDays(floorDiv(utc + stdOffset_, kSecondsPerDay));
+    int64_t start = ruleTime(year, dstStart_) - stdOffset_;
+    int64_t end = ruleTime(year, dstEnd_) - dstOffset_;
+    bool dst = start < end ? (utc >= start && utc < end) : !(utc >= end && utc < start);
+    return dst ? dstOffset_ : stdOffset_;
+}
+
+int64_t TimeZone::offsetAt(int64_t utc) const {
+#if TRADING_HAS_CHRONO_TZDB
+    if (zone_ != nullptr) {
+        auto info = zone_->get_info(std::chrono::sys_seconds(std::chrono::seconds(utc)));
+        return std::chrono::duration_cast<std::chrono::seconds>(info.offset).count();
+    }
+#endif
+    if (transitions_.empty()) {
+        return hasRule_ ? ruleOffsetAt(utc) : initialOffset_;
+    }
+    if (utc < transitions_.front()) {
+        return initialOffset_;
+    }
+    if (utc >= transitions_.back() && hasRule_) {
+        return ruleOffsetAt(utc);
+    }
+    auto it = std::upper_bound(transitions_.begin(), transitions_.end(), utc);
+    return offsets_[static_cast<size_t>(it - transitions_.begin()) - 1];
+}
+
+int64_t TimeZone::toUtc(int64_t local) const {
+    // 候选偏移取附近前后一天的偏移，换算结果的偏移与所用偏移一致才有效
+    int64_t guess = local - offsetAt(local);
+    int64_t before = offsetAt(guess - kSecondsPerDay);
+    int64_t after = offsetAt(guess + kSecondsPerDay);
+    bool beforeValid = offsetAt(local - before) == before;
+    bool afterValid = offsetAt(local - after) == after;
+    if (beforeValid && afterValid) {
+        // 本地时间重复时取较早的一个
+        return std::min(local - before, local - after);
+    }
+    if (afterValid) {
+        return local - after;
+    }
+    // 有效或夏令时跳过的本地时间，按跳变前的偏移换算
+    return local - before;
+}
+
+SessionCalendar::SessionCalendar(const SymbolConfig& config, int64_t duration)
+    : zone_(TimeZone::load(config.timezone))
+    , sessionOffset_(config.sessionOffset)
+    , duration_(duration) {
+    if (duration_ <= 0) {
+        throw std::runtime_error("Session calendar requires a positive bar duration");
+    }
+    if (duration_ >= kSecondsPerDay && duration_ % kSecondsPerDay != 0) {
+        throw std::runtime_error("Session-aligned bars longer than a day must span whole days");
+    }
+}
+
+int64_t SessionCalendar::sessionStart(int64_t day) const {
+    return zone_.toUtc(day * kSecondsPerDay + sessionOffset_);
+}
+
+void SessionCalendar::generateDay() {
+    int64_t day = nextDay_++;
+    int64_t start = sessionStart(day);
+    if (duration_ >= kSecondsPerDay) {
+        if (floorDiv(day, duration_ / kSecondsPerDay) * (duration_ / kSecondsPerDay) == day) {
+            boundaries_.push_back(start);
+        }
+        return;
+    }
+    int64_t end = sessionStart(day + 1);
+    for (int64_t t = start; t < end; t += duration_) {
+        boundaries_.push_back(t);
+    }
+}
+
+int64_t SessionCalendar::open(int64_t time) {
+    if (boundaries_.empty() || time < boundaries_.front()) {
+        // session可能从前一个本地日期开始，多日K线还需回溯到对齐的日期
+        boundaries_.clear();
+        cursor_ = 0;
+        int64_t localDay = floorDiv(time + zone_.offsetAt(time) - sessionOffset_, kSecondsPerDay);
+        nextDay_ = localDay - 1 - duration_ / kSecondsPerDay;
+    }
+    while (boundaries_.empty() || boundaries_.back() <= time) {
+        generateDay();
+    }
+    // 按时间顺序打开K线时游标只向前移动
+    if (boundaries_[cursor_] > time) {
+        cursor_ = 0;
+    }
+    while (boundaries_[cursor_ + 1] <= time) {
+        cursor_++;
+    }
+    return boundaries_[cursor_];
+}
+
+} // namespace trading
@@ -0,0 +1,125 @@
+#include "symbol_registry.h"
+#include "precision.h"
+#include "json.hpp"
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace trading {
+
+using json = nlohmann::json;
+
+namespace {
+
+SymbolConfig makeConfig(int pricePrecision, int volumePrecision, int scale,
+                        int lotPrecision = kDefaultLotPrecision) {
+    SymbolConfig config;
+    config.pricePrecision = pricePrecision;
+    config.volumePrecision = volumePrecision;
+    config.scale = scale;
+    config.lotPrecision = lotPrecision;
+    return config;
+}
+
+// 只覆盖 fields 中出现的字段
+void applyFields(const json& fields, SymbolConfig& config) {
+    auto read = [&](const char* key, auto& value) {
+        auto it = fields.find(key);
+        if (it != fields.end()) {
+            it->get_to(value);
+        }
+    };
+    read("pricePrecision", config.pricePrecision);
+    read("volumePrecision", config.volumePrecision);
+    read("scale", config.scale);
+    read("lotPrecision", config.lotPrecision);
+    read("duration", config.duration);
+    read("durations", config.durations);
+    read("profileDurations", config.profileDurations);
+}
+
+void validate(const std::string& symbol, const SymbolConfig& config) {
+    auto require = [&](bool condition, const char* message) {
+        if (!condition) {
+            throw std::runtime_error("Invalid config for symbol " + symbol + ": " + message);
+        }
+    };
+    require(config.scale > 0, "scale must be positive");
+    require(config.pricePrecision >= 0 && config.pricePrecision <= 12,
+            "pricePrecision must be in [0, 12]");
+    require(config.volumePrecision >= 0 && config.volumePrecision <= config.lotPrecision,
+            "volumePrecision must be in [0, lotPrecision]");
+    require(config.lotPrecision >= 0 && config.lotPrecision <= 18, "lotPrecision must be in [0, 18]");
+    require(config.duration > 0, "duration must be positive");
+    for (auto duration : config.durations) {
+        require(duration > 0, "durations must be positive");
+    }
+}
+
+} // namespace
+
+SymbolRegistry SymbolRegistry::fromFile(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file) {
+        throw std::runtime_error("Failed to open symbol config: " + filename);
+    }
+    json root;
+    try {
+        root = json::parse(file);
+    } catch (const json::exception& e) {
+        throw std::runtime_error("Failed to parse symbol config " + filename + ": " + e.what());
+    }
+
+    SymbolConfig defaults;
+    if (root.contains("defaults")) {
+        applyFields(root.at("defaults"), defaults);
+    }
+    SymbolRegistry registry(defaults);
+    if (!root.contains("symbols") || !root.at("symbols").is_object()) {
+        throw std::runtime_error("Symbol config " + filename + " has no \"symbols\" object");
+    }
+    for (const auto& [symbol, fields] : root.at("symbols").items()) {
+        SymbolConfig config = defaults;
+        try {
+            applyFields(fields, config);
+        } catch (const json::exception& e) {
+            throw std::runtime_error("Invalid config for symbol " + symbol + ": " + e.what());
+        }
+        validate(symbol, config);
+        registry.add(symbol, config);
+    }
+    return registry;
+}
+
+SymbolRegistry SymbolRegistry::withDefaults() {
+    SymbolRegistry registry;
+    registry.add("BTCUSDT", makeConfig(1, 2, 100));
+    registry.add("ETHUSDT", makeConfig(2, 3, 10));
+    registry.add("SOLUSDT", makeConfig(2, 2, 1));
+    // 数量步长为1，单笔可达1e9以上，1e-8的lot会超出int64范围
+    registry.add("PEPEUSDT", makeConfig(8, 0, 1, 0));
+    return registry;
+}
+
+void SymbolRegistry::add(const std::string& symbol, const SymbolConfig& config) {
+    configs_[symbol] = config;
+}
+
+bool SymbolRegistry::contains(const std::string& symbol) const {
+    return configs_.count(symbol) > 0;
+}
+
+const SymbolConfig& SymbolRegistry::get(const std::string& symbol) const {
+    auto it = configs_.find(symbol);
+    if (it == configs_.end()) {
+        throw std::runtime_error("No config for symbol " + symbol);
+    }
+    return it->second;
+}
+
+std::string SymbolRegistry::symbolFromFilename(const std::string& filename) {
+    std::string name = std::filesystem::path(filename).filename().string();
+    return name.substr(0, name.find('-'));
+}
+
+} // namespace trading
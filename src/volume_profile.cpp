@@ -0,0 +1,186 @@
+#include "volume_profile.h"
+#include "precision.h"
+#include "json.hpp"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace trading {
+
+using json = nlohmann::json;
+
+namespace {
+
+template <typename T>
+void writeValue(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool readValue(std::istream& in, T& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+void accumulate(VolumeProfile::Level& target, const VolumeProfile::Level& source) {
+    target.volume += source.volume;
+    target.bidSize += source.bidSize;
+    target.askSize += source.askSize;
+    target.tradesCount += source.tradesCount;
+}
+
+void accumulate(VolumeProfile::Level& target, const FootprintBar::PriceLevel& source) {
+    target.volume += source.volume;
+    target.bidSize += source.bidSize;
+    target.askSize += source.askSize;
+    target.tradesCount += source.tradesCount;
+}
+
+} // namespace
+
+VolumeProfile::VolumeProfile(int64_t sessionStart, int64_t duration, int scale,
+                             int volumePrecision, int pricePrecision, int lotPrecision)
+    : sessionStart(sessionStart)
+    , duration(duration)
+    , scale(scale)
+    , volumePrecision(volumePrecision)
+    , pricePrecision(pricePrecision)
+    , lotPrecision(lotPrecision) {}
+
+template <typename Source>
+void VolumeProfile::mergeLevels(const Source& other) {
+    // 两个有序档位数组线性归并
+    std::vector<Level> merged;
+    merged.reserve(levels.size() + other.size());
+    auto it = levels.begin();
+    for (const auto& level : other) {
+        if (level.tradesCount == 0) continue;
+        while (it != levels.end() && it->level < level.level) {
+            merged.push_back(*it++);
+        }
+        if (it != levels.end() && it->level == level.level) {
+            merged.push_back(*it++);
+        } else {
+            merged.push_back(Level{level.level});
+        }
+        accumulate(merged.back(), level);
+    }
+    merged.insert(merged.end(), it, levels.end());
+    levels.swap(merged);
+}
+
+void VolumeProfile::addBar(const FootprintBar& bar) {
+    mergeLevels(bar.priceLevels);
+}
+
+void VolumeProfile::merge(const VolumeProfile& other) {
+    if (other.scale != scale || other.lotPrecision != lotPrecision) {
+        throw std::runtime_error("Cannot merge volume profiles with different scales or lot sizes");
+    }
+    int64_t end = std::max(sessionStart + duration, other.sessionStart + other.duration);
+    sessionStart = std::min(sessionStart, other.sessionStart);
+    duration = end - sessionStart;
+    mergeLevels(other.levels);
+}
+
+void VolumeProfile::write(std::ostream& out) const {
+    writeValue(out, sessionStart);
+    writeValue(out, duration);
+    writeValue(out, static_cast<int32_t>(scale));
+    writeValue(out, static_cast<int32_t>(volumePrecision));
+    writeValue(out, static_cast<int32_t>(pricePrecision));
+    writeValue(out, static_cast<int32_t>(lotPrecision));
+    writeValue(out, static_cast<uint32_t>(levels.size()));
+    out.write(reinterpret_cast<const char*>(levels.data()),
+              static_cast<std::streamsize>(levels.size() * sizeof(Level)));
+}
+
+bool VolumeProfile::read(std::istream& in) {
+    int32_t scaleValue = 0;
+    int32_t volumePrecisionValue = 0;
+    int32_t pricePrecisionValue = 0;
+    int32_t lotPrecisionValue = 0;
+    uint32_t levelCount = 0;
+    if (!readValue(in, sessionStart)) {
+        return false;
+    }
+    if (!readValue(in, duration) || !readValue(in, scaleValue) ||
+        !readValue(in, volumePrecisionValue) || !readValue(in, pricePrecisionValue) ||
+        !readValue(in, lotPrecisionValue) || !readValue(in, levelCount)) {
+        throw std::runtime_error("Truncated volume profile record");
+    }
+    scale = scaleValue;
+    volumePrecision = volumePrecisionValue;
+    pricePrecision = pricePrecisionValue;
+    lotPrecision = lotPrecisionValue;
+    levels.resize(levelCount);
+    if (!in.read(reinterpret_cast<char*>(levels.data()),
+                 static_cast<std::streamsize>(levels.size() * sizeof(Level)))) {
+        throw std::runtime_error("Truncated volume profile record");
+    }
+    return true;
+}
+
+std::string VolumeProfile::toJson() const {
+    RuntimePrecision precision(pricePrecision, volumePrecision, scale, lotPrecision);
+
+    json j;
+    j["sessionStart"] = sessionStart;
+    j["duration"] = duration;
+    j["scale"] = scale;
+    json levelsJson = json::array();
+    for (const auto& level : levels) {
+        levelsJson.push_back({
+            precision.levelToPrice(level.level),
+            precision.roundLots(level.volume),
+            precision.roundLots(level.bidSize),
+            precision.roundLots(level.askSize),
+            level.tradesCount,
+        });
+    }
+    j["levels"] = levelsJson;
+    return j.dump();
+}
+
+void writeProfiles(const std::string& filename, const std::vector<VolumeProfile>& profiles) {
+    std::ofstream outfile(filename, std::ios::binary);
+    if (!outfile) {
+        throw std::runtime_error("Failed to open output file: " + filename);
+    }
+    for (const auto& profile : profiles) {
+        profile.write(outfile);
+    }
+}
+
+std::vector<VolumeProfile> readProfiles(const std::string& filename) {
+    std::ifstream infile(filename, std::ios::binary);
+    if (!infile) {
+        throw std::runtime_error("Failed to open file: " + filename);
+    }
+    std::vector<VolumeProfile> profiles;
+    VolumeProfile profile;
+    while (profile.read(infile)) {
+        profiles.push_back(std::move(profile));
+        profile = VolumeProfile();
+    }
+    return profiles;
+}
+
+VolumeProfile compositeProfile(const std::vector<VolumeProfile>& profiles,
+                               int64_t from, int64_t to) {
+    VolumeProfile composite(from, to - from);
+    bool first = true;
+    for (const auto& profile : profiles) {
+        if (profile.sessionStart < from || profile.sessionStart >= to) continue;
+        if (first) {
+            composite.scale = profile.scale;
+            composite.volumePrecision = profile.volumePrecision;
+            composite.pricePrecision = profile.pricePrecision;
+            composite.lotPrecision = profile.lotPrecision;
+            first = false;
+        }
+        composite.merge(profile);
+    }
+    return composite;
+}
+
+} // namespace trading